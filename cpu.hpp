@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cstdint>
 
 
@@ -6,123 +8,966 @@ using word = uint16_t;
 using byte = uint8_t;
 using flag = bool;
 
+class Metrics;
+
+// base cycles of each opcode, extra cycles of taken branches
+// are added by instructionBranch
+inline constexpr byte opcodeCycles[256] = {
+    7, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6, // 0x00
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 0x10
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6, // 0x20
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 0x30
+    6, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6, // 0x40
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 0x50
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6, // 0x60
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 0x70
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, // 0x80
+    2, 6, 2, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5, // 0x90
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, // 0xA0
+    2, 5, 2, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, // 0xB0
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, // 0xC0
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 0xD0
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, // 0xE0
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 0xF0
+};
+
 class CPU
 {
 public:
 
     // CPU
-    auto powerCPU(void)         -> void;
-    auto displayRegisters(void) -> void;
+    auto powerCPU(void)                           -> void;
+    auto resetCPU(void)                           -> void;
+    auto displayRegisters(void)                   -> void;
+    constexpr auto statusRegister(void) const     -> byte;
+    constexpr auto setStatusRegister(byte status) -> void;
+
+    // execution
+    // runs until cycles reaches until, usually the next device event
+    auto run(uint64_t until)                                        -> void;
+    // runs count instructions
+    auto step(uint64_t count)                                       -> void;
+    auto execute(uint64_t untilCycles, uint64_t untilInstructions)  -> void;
+    auto skipIdle(uint64_t untilCycles, uint64_t untilInstructions) -> void;
+    // minimal executor that also works in constant expressions: calls
+    // the routine at addr like a JSR and returns true once it returns,
+    // false on a bad opcode or after limit instructions
+    constexpr auto call(word addr, uint64_t limit)                  -> bool;
 
     // memory
-    auto readMemory(void)                             -> byte;
-    auto loadMemory(word addr)                        -> byte;
-    auto storeMemory(word data, byte reg)             -> void;
-    auto initializeMem(void)                          -> void;
-    auto displayMemory(uint16_t first, uint16_t last) -> void;
+    constexpr auto readMemory(void)                            -> byte;
+    constexpr auto loadMemory(word addr)                       -> byte;
+    constexpr auto storeMemory(word data, byte reg)            -> void;
+    auto initializeMem(void)                                   -> void;
+    auto loadImage(const byte* data, uint32_t size, word addr) -> uint32_t;
+    auto loadFile(const char* path, word addr)                 -> bool;
+    auto displayMemory(uint16_t first, uint16_t last)          -> void;
 
     // function pointer
     using fp = auto (CPU::*)(byte) -> byte;
 
     // instructions
-    auto instruction(void) -> void;
+    constexpr auto instruction(void) -> void;
 
     // opcodes that modify values
-    auto instructionADC(byte data) -> byte;
-    auto instructionAND(byte data) -> byte;
-    auto instructionASL(byte data) -> byte;
-    auto instructionBIT(byte data) -> byte;
-    auto instructionCMP(byte data) -> byte;
-    auto instructionCMX(byte data) -> byte;
-    auto instructionCMY(byte data) -> byte;
-    auto instructionDEC(byte data) -> byte;
-    auto instructionEOR(byte data) -> byte;
-    auto instructionINC(byte data) -> byte;
-    auto instructionLDA(byte data) -> byte;
-    auto instructionLSR(byte data) -> byte;
-    auto instructionORA(byte data) -> byte;
-    auto instructionROL(byte data) -> byte;
-    auto instructionROR(byte data) -> byte;
-    auto instructionSBC(byte data) -> byte;
+    constexpr auto instructionADC(byte data) -> byte;
+    constexpr auto instructionAND(byte data) -> byte;
+    constexpr auto instructionASL(byte data) -> byte;
+    constexpr auto instructionBIT(byte data) -> byte;
+    constexpr auto instructionCMP(byte data) -> byte;
+    constexpr auto instructionCMX(byte data) -> byte;
+    constexpr auto instructionCMY(byte data) -> byte;
+    constexpr auto instructionDEC(byte data) -> byte;
+    constexpr auto instructionEOR(byte data) -> byte;
+    constexpr auto instructionINC(byte data) -> byte;
+    constexpr auto instructionLDA(byte data) -> byte;
+    constexpr auto instructionLSR(byte data) -> byte;
+    constexpr auto instructionORA(byte data) -> byte;
+    constexpr auto instructionROL(byte data) -> byte;
+    constexpr auto instructionROR(byte data) -> byte;
+    constexpr auto instructionSBC(byte data) -> byte;
 
     // opcodes for the stack
-    auto instructionPushA(void) -> void;
-    auto instructionPullA(void) -> void;
-    auto instructionPushS(void) -> void;
-    auto instructionPullS(void) -> void;
+    constexpr auto instructionPushA(void) -> void;
+    constexpr auto instructionPullA(void) -> void;
+    constexpr auto instructionPushS(void) -> void;
+    constexpr auto instructionPullS(void) -> void;
 
     // opcode that does nothing
-    auto instructionNOP(void) -> void;
+    constexpr auto instructionNOP(void) -> void;
 
     // branch operations
-    auto instructionBranch(bool decision) -> void;
+    constexpr auto instructionBranch(bool decision) -> void;
 
     // jump operations
-    auto instructionJumpAbsolute(void) -> void;
-    auto instructionJumpIndirect(void) -> void;
+    constexpr auto instructionJumpAbsolute(void) -> void;
+    constexpr auto instructionJumpIndirect(void) -> void;
 
     // jump to/from subroutines operations
-    auto instructionJumpSubroutines(void) -> void;
-    auto instructionFromSubroutines(void) -> void;
+    constexpr auto instructionJumpSubroutines(void) -> void;
+    constexpr auto instructionFromSubroutines(void) -> void;
 
     // status instructions
-    auto instructionClear(bool& status) -> void;
-    auto instructionSet(bool& status)   -> void;
+    constexpr auto instructionClear(bool& status) -> void;
+    constexpr auto instructionSet(bool& status)   -> void;
 
     // interrupt instructions
-    auto instructionInterrupt(void) -> void;
-    auto instructionReturnInter(void)  -> void;
+    constexpr auto instructionInterrupt(void)   -> void;
+    constexpr auto instructionReturnInter(void) -> void;
 
     // addressing modes
-    auto instructionImmediate(fp instr, byte& reg)                 -> void;
-    auto instructionZeroPageRead(fp instr, byte& reg)              -> void;
-    auto instructionZeroPageRead(fp instr, byte& reg, byte& index) -> void;
-    auto instructionAbsoluteRead(fp instr, byte& reg)              -> void;
-    auto instructionAbsoluteRead(fp instr, byte& reg, byte& index) -> void;
-    auto instructionIndirectXRead(fp instr, byte& reg)             -> void;
-    auto instructionIndirectYRead(fp instr, byte& reg)             -> void;
-    auto instructionTransfer(fp instr, byte& to, byte& from)       -> void;
-    auto instructionImplied(fp instr, byte& data)                  -> void;
-
-    auto instructionZeroPageStore(byte& reg)                       -> void;
-    auto instructionZeroPageStore(byte& reg, byte& index)          -> void;
-    auto instructionAbsoluteStore(byte& reg)                       -> void;
-    auto instructionAbsoluteStore(byte& reg, byte& index)          -> void;
-    auto instructionIndirectXStore(byte& reg)                      -> void;
-    auto instructionIndirectYStore(byte& reg)                      -> void;
-
-    auto instructionZeroPageData(fp instr)                         -> void;
-    auto instructionZeroPageData(fp instr, byte& index)            -> void;
-    auto instructionAbsoluteData(fp instr)                         -> void;
-    auto instructionAbsoluteData(fp instr, byte& index)            -> void;
-    auto instructionIndirectXData(fp instr)                        -> void;
-    auto instructionIndirectYData(fp instr)                        -> void;
+    constexpr auto instructionImmediate(fp instr, byte& reg)                 -> void;
+    constexpr auto instructionZeroPageRead(fp instr, byte& reg)              -> void;
+    constexpr auto instructionZeroPageRead(fp instr, byte& reg, byte& index) -> void;
+    constexpr auto instructionAbsoluteRead(fp instr, byte& reg)              -> void;
+    constexpr auto instructionAbsoluteRead(fp instr, byte& reg, byte& index) -> void;
+    constexpr auto instructionIndirectXRead(fp instr, byte& reg)             -> void;
+    constexpr auto instructionIndirectYRead(fp instr, byte& reg)             -> void;
+    constexpr auto instructionTransfer(fp instr, byte& to, byte& from)       -> void;
+    constexpr auto instructionImplied(fp instr, byte& data)                  -> void;
+
+    constexpr auto instructionZeroPageStore(byte& reg)                       -> void;
+    constexpr auto instructionZeroPageStore(byte& reg, byte& index)          -> void;
+    constexpr auto instructionAbsoluteStore(byte& reg)                       -> void;
+    constexpr auto instructionAbsoluteStore(byte& reg, byte& index)          -> void;
+    constexpr auto instructionIndirectXStore(byte& reg)                      -> void;
+    constexpr auto instructionIndirectYStore(byte& reg)                      -> void;
+
+    constexpr auto instructionZeroPageData(fp instr)                         -> void;
+    constexpr auto instructionZeroPageData(fp instr, byte& index)            -> void;
+    constexpr auto instructionAbsoluteData(fp instr)                         -> void;
+    constexpr auto instructionAbsoluteData(fp instr, byte& index)            -> void;
+    constexpr auto instructionIndirectXData(fp instr)                        -> void;
+    constexpr auto instructionIndirectYData(fp instr)                        -> void;
 
     // Stack PC operations
-    auto pullPC(void) -> void;
-    auto pushPC(void) -> void;
+    constexpr auto pullPC(void) -> void;
+    constexpr auto pushPC(void) -> void;
 
+    // coverage
+    constexpr auto recordEdge(word from, word to) -> void;
 
 
+    // every member is initialized so a CPU can live in a constant expression
     struct Memory
     {
-        constexpr static word size{65534};
-        byte ram[size];
+        constexpr static uint32_t size{0x10000};
+        byte ram[size]{};
+    };
+
+    Memory mem{};
+
+    // a loop iteration that ends where it started, with the same
+    // registers and no side effects, will repeat until a device
+    // changes memory, so its cycles can be skipped
+    struct Idle
+    {
+        bool armed;
+        word head;
+        byte A, X, Y, SP, P;
+        uint64_t effects;
+        uint64_t cycles;
+        uint64_t instructions;
     };
 
-    Memory mem;
+    Idle idle{};
+    flag idleSkip{true};
+
+    uint64_t cycles{};       // Cycles elapsed
+    uint64_t instructions{}; // Instructions retired
+    uint64_t effects{};      // Memory writes, bumped on every side effect
+    uint64_t interrupts{};   // BRKs taken
+    uint64_t writeHash{};    // Rolling hash of every address and value written
+
+    // why run() returned
+    enum class Stop : byte
+    {
+        Running,
+        Until,
+        BadOpcode,
+    };
+
+    Stop stop{};
+
+    // published every metrics->interval instructions when set
+    Metrics* metrics{};
+    uint64_t publishAt{};
+
+    // called by run() and step() after every instruction, or after a
+    // skipped idle loop, when set. Returning false stops there
+    using watcher = auto (*)(void* user, CPU& cpu) -> bool;
+    watcher watch{};
+    void* watchUser{};
+
+    // pages written since they were last cleared, so a snapshot
+    // can be restored by copying only these
+    constexpr static uint32_t pages{256};
+    byte dirty[pages]{};
+
+    // handlers for memory mapped I/O, per page. Data reads and writes
+    // to a page with a handler go to it instead of ram. A stable page
+    // promises its reads return the same value until the next run()
+    // or step(), so polling it can still be skipped as an idle loop
+    using ioRead  = auto (*)(void* user, word addr) -> byte;
+    using ioWrite = auto (*)(void* user, word addr, byte data) -> void;
+
+    struct IO
+    {
+        ioRead read;
+        ioWrite write;
+        void* user;
+        bool stable;
+    };
 
-    word PC; // Program Counter
-    byte SP; // Stack Pointer
-    byte A;  // Accumulator
-    byte X;  // Index Register X
-    byte Y;  // Index Register Y
+    IO io[pages]{};
+
+    // hit counts of branches, JMPs and JSRs when set, indexed by a
+    // hash of the source and target addresses. Counts stop at 255
+    constexpr static uint32_t coverageSize{0x10000};
+    byte* coverage{};
+    // when set, every edge whose count leaves zero is appended here,
+    // so a fuzzer can check and clear only those
+    word* edges{};
+    uint32_t edgeCount{};
+
+    // reads (fetches included) and writes per page when set, which
+    // turns off idle loop skipping so every access is counted
+    struct Heat
+    {
+        uint32_t reads[pages];
+        uint32_t writes[pages];
+    };
+
+    Heat* heat{};
+
+    word PC{}; // Program Counter
+    byte SP{}; // Stack Pointer
+    byte A{};  // Accumulator
+    byte X{};  // Index Register X
+    byte Y{};  // Index Register Y
 
     // Process status
-    flag C;  // Carry
-    flag Z;  // Zero
-    flag I;  // Interrupt Disable
-    flag D;  // Decimal Mode
-    flag V;  // Overflow
-    flag N;  // Negative
+    flag C{};  // Carry
+    flag Z{};  // Zero
+    flag I{};  // Interrupt Disable
+    flag D{};  // Decimal Mode
+    flag V{};  // Overflow
+    flag N{};  // Negative
 };
+
+// the core lives in the header so routines can run at compile time,
+// see routine.hpp. At run time it is the same code
+
+constexpr auto CPU::statusRegister(void) const -> byte
+{
+    return (N ? 1 : 0) << 7 | (V ? 1 : 0) << 6 | (D ? 1 : 0) << 3 |
+        (I ? 1 : 0) << 2 | (Z ? 1 : 0) << 1 | (C ? 1 : 0);
+}
+
+constexpr auto CPU::setStatusRegister(byte status) -> void
+{
+    N = status & 0x80;
+    V = status & 0x40;
+    D = status & 0x08;
+    I = status & 0x04;
+    Z = status & 0x02;
+    C = status & 0x01;
+}
+
+// execution
+constexpr auto CPU::call(word addr, uint64_t limit) -> bool
+{
+    // return to 0xFFFF, the last byte of the vectors, which is never code
+    byte top = SP;
+    PC = 0xFFFE;
+    pushPC();
+    PC = addr;
+
+    stop = Stop::Running;
+    for (uint64_t count = 0; count < limit; count++) {
+        instruction();
+        if (stop != Stop::Running)
+            return false;
+        if (PC == 0xFFFF && SP == top) {
+            stop = Stop::Until;
+            return true;
+        }
+    }
+    stop = Stop::Until;
+    return false;
+}
+
+// memory
+constexpr auto CPU::readMemory(void) -> byte
+{
+    if (heat)
+        heat->reads[PC >> 8]++;
+    return mem.ram[PC++];
+}
+
+constexpr auto CPU::loadMemory(word addr) -> byte
+{
+    if (heat)
+        heat->reads[addr >> 8]++;
+    auto& page = io[addr >> 8];
+    if (page.read) {
+        // a device may answer differently each time, so polling
+        // it is never an idle loop unless the page is stable
+        if (!page.stable)
+            effects++;
+        return page.read(page.user, addr);
+    }
+    return mem.ram[addr];
+}
+
+constexpr auto CPU::storeMemory(word data, byte reg) -> void
+{
+    if (heat)
+        heat->writes[data >> 8]++;
+    auto& page = io[data >> 8];
+    if (page.write) {
+        page.write(page.user, data, reg);
+    } else {
+        mem.ram[data] = reg;
+        dirty[data >> 8] = 1;
+    }
+    effects++;
+    // FNV-1a step, so two runs can compare writes without comparing memory
+    writeHash = (writeHash ^ (static_cast<uint32_t>(data) << 8 | reg)) * 0x100000001B3;
+}
+
+// instructions
+constexpr auto CPU::instruction(void) -> void
+{
+    byte opcode = readMemory();
+    cycles += opcodeCycles[opcode];
+    instructions++;
+    switch(opcode) {
+        case 0x00: instructionInterrupt(); break;                              // BRK
+        case 0x01: instructionIndirectXRead(&CPU::instructionORA, A); break;   // ORA (Indirect,X)
+        case 0x05: instructionZeroPageRead(&CPU::instructionORA, A); break;    // ORA Zero Page
+        case 0x06: instructionZeroPageData(&CPU::instructionASL); break;       // ASL Zero Page
+        case 0x08: instructionPushS(); break;                                  // PHP
+        case 0x09: instructionImmediate(&CPU::instructionORA, A); break;       // ORA Immediate
+        case 0x0A: instructionImplied(&CPU::instructionASL, A); break;         // ASL Accumulator
+        case 0x0D: instructionAbsoluteRead(&CPU::instructionORA, A); break;    // ORA Absolute
+        case 0x0E: instructionAbsoluteData(&CPU::instructionASL); break;       // ASL Absolute
+        case 0x10: instructionBranch(!N); break;                               // BPL
+        case 0x11: instructionIndirectYRead(&CPU::instructionORA, A); break;   // ORA (Indirect),Y
+        case 0x15: instructionZeroPageRead(&CPU::instructionORA, A, X); break; // ORA Zero Page,X
+        case 0x16: instructionZeroPageData(&CPU::instructionASL, X); break;    // ASL Zero Page,X
+        case 0x18: instructionClear(C); break;                                 // CLC
+        case 0x19: instructionAbsoluteRead(&CPU::instructionORA, A, Y); break; // ORA Absolute,Y
+        case 0x1D: instructionAbsoluteRead(&CPU::instructionORA, A, X); break; // ORA Absolute,X
+        case 0x1E: instructionAbsoluteData(&CPU::instructionASL, X); break;    // ASL Absolute,X
+        case 0x20: instructionJumpSubroutines(); break;                        // JSR
+        case 0x21: instructionIndirectXRead(&CPU::instructionADC, A); break;   // AND (Indirect,X)
+        case 0x24: instructionZeroPageRead(&CPU::instructionBIT, A); break;    // BIT Zero Page
+        case 0x25: instructionZeroPageRead(&CPU::instructionADC, A); break;    // AND Zero Page
+        case 0x26: instructionZeroPageData(&CPU::instructionROL); break;       // ROL Zero Page
+        case 0x28: instructionPullS(); break;                                  // PLP
+        case 0x29: instructionImmediate(&CPU::instructionADC, A); break;       // AND Immediate
+        case 0x2A: instructionImplied(&CPU::instructionROL, A); break;         // ROL Accumulator
+        case 0x2C: instructionAbsoluteRead(&CPU::instructionBIT, A); break;    // BIT Absolute
+        case 0x2D: instructionAbsoluteRead(&CPU::instructionADC, A); break;    // AND Absolute
+        case 0x2E: instructionAbsoluteData(&CPU::instructionROL); break;       // ROL Absolute
+        case 0x30: instructionBranch(N); break;                                // BMI
+        case 0x31: instructionIndirectYRead(&CPU::instructionADC, A); break;   // AND (Indirect),Y
+        case 0x35: instructionZeroPageRead(&CPU::instructionADC, A, X); break; // AND Zero Page,X
+        case 0x36: instructionZeroPageData(&CPU::instructionROL, X); break;    // ROL Zero Page,X
+        case 0x38: instructionSet(C); break;                                   // SEC
+        case 0x39: instructionAbsoluteRead(&CPU::instructionADC, A, Y); break; // AND Absolute,Y
+        case 0x3D: instructionAbsoluteRead(&CPU::instructionADC, A, X); break; // AND Absolute,X
+        case 0x3E: instructionAbsoluteData(&CPU::instructionROL, X); break;    // ROL Absolute,X
+        case 0x40: instructionReturnInter(); break;                            // RTI
+        case 0x41: instructionIndirectXRead(&CPU::instructionEOR, A); break;   // EOR (Indirect,X)
+        case 0x45: instructionZeroPageRead(&CPU::instructionEOR, A); break;    // EOR Zero Page
+        case 0x46: instructionZeroPageData(&CPU::instructionLSR); break;       // LSR Zero Page
+        case 0x48: instructionPushA(); break;                                  // PHA
+        case 0x49: instructionImmediate(&CPU::instructionEOR, A); break;       // EOR Immediate
+        case 0x4A: instructionImplied(&CPU::instructionLSR, A); break;         // LSR Accumulator
+        case 0x4C: instructionJumpAbsolute(); break;                           // JMP Absolute
+        case 0x4D: instructionAbsoluteRead(&CPU::instructionEOR, A); break;    // EOR Absolute
+        case 0x4E: instructionAbsoluteData(&CPU::instructionLSR); break;       // LSR Absolute
+        case 0x50: instructionBranch(!V); break;                               // BVC
+        case 0x51: instructionIndirectYRead(&CPU::instructionEOR, A); break;   // EOR (Indirect),Y
+        case 0x55: instructionZeroPageRead(&CPU::instructionEOR, A, X); break; // EOR Zero Page,X
+        case 0x56: instructionZeroPageRead(&CPU::instructionLSR, X); break;    // LSR Zero Page,X
+        case 0x58: instructionClear(I); break;                                 // CLI
+        case 0x59: instructionAbsoluteRead(&CPU::instructionEOR, A, Y); break; // EOR Absolute,Y
+        case 0x5D: instructionAbsoluteRead(&CPU::instructionEOR, A, X); break; // EOR Absolute,X
+        case 0x5E: instructionAbsoluteData(&CPU::instructionLSR, X); break;    // LSR Absolute,X
+        case 0x60: instructionFromSubroutines(); break;                        // RTS
+        case 0x61: instructionIndirectXRead(&CPU::instructionADC, A); break;   // ADC (Indirect,X)
+        case 0x65: instructionZeroPageRead(&CPU::instructionADC, A); break;    // ADC Zero Page
+        case 0x66: instructionZeroPageData(&CPU::instructionROR); break;       // ROR Zero Page
+        case 0x68: instructionPullA(); break;                                  // PLA
+        case 0x69: instructionImmediate(&CPU::instructionADC, A); break;       // ADC Immediate
+        case 0x6A: instructionImplied(&CPU::instructionROR, A); break;         // ROR Accumulator
+        case 0x6C: instructionJumpIndirect(); break;                           // JMP Indirect
+        case 0x6D: instructionAbsoluteRead(&CPU::instructionADC, A); break;    // ADC Absolute
+        case 0x6E: instructionAbsoluteData(&CPU::instructionROR); break;       // ROR Absolute
+        case 0x70: instructionBranch(V); break;                                // BVS
+        case 0x71: instructionIndirectYRead(&CPU::instructionADC, A); break;   // ADC (Indirect),Y
+        case 0x75: instructionZeroPageRead(&CPU::instructionADC, A, X); break; // ADC Zero Page,X
+        case 0x76: instructionZeroPageData(&CPU::instructionROR, X); break;    // ROR Zero Page,X
+        case 0x78: instructionSet(I); break;                                   // SEI
+        case 0x79: instructionAbsoluteRead(&CPU::instructionADC, A, Y); break; // ADC Absolute,Y
+        case 0x7D: instructionAbsoluteRead(&CPU::instructionADC, A, X); break; // ADC Absolute,X
+        case 0x7E: instructionAbsoluteData(&CPU::instructionROR, X); break;    // ROR Absolute,X
+        case 0x81: instructionIndirectXStore(A); break;                        // STA (Indirect,X)
+        case 0x84: instructionZeroPageStore(Y); break;                         // STY Zero Page
+        case 0x85: instructionZeroPageStore(A); break;                         // STA Zero Page
+        case 0x86: instructionZeroPageStore(X); break;                         // STX Zero Page
+        case 0x88: instructionImplied(&CPU::instructionDEC, Y); break;         // DEY
+        case 0x8A: instructionTransfer(&CPU::instructionLDA, A, X); break;     // TXA
+        case 0x8C: instructionAbsoluteStore(Y); break;                         // STY Absolute
+        case 0x8D: instructionAbsoluteStore(A); break;                         // STA Absolute
+        case 0x8E: instructionAbsoluteStore(X); break;                         // STX Absolute
+        case 0x90: instructionBranch(!C); break;                               // BBC
+        case 0x91: instructionIndirectYStore(A); break;                        // STA (Indirect),Y
+        case 0x94: instructionZeroPageStore(Y, X); break;                      // STY Zero Page,X
+        case 0x95: instructionZeroPageStore(A, X); break;                      // STA Zero Page,X
+        case 0x96: instructionZeroPageStore(X, Y); break;                      // STX Zero Page,Y
+        case 0x98: instructionTransfer(&CPU::instructionLDA, A, Y); break;     // TYA
+        case 0x99: instructionAbsoluteStore(A, Y); break;                      // STA Absolute,Y
+        case 0x9A: instructionTransfer(&CPU::instructionLDA, SP, X); break;    // TXS
+        case 0x9D: instructionAbsoluteStore(A, X); break;                      // STA Absolute,X
+        case 0xA0: instructionImmediate(&CPU::instructionLDA, Y); break;       // LDY Immediate
+        case 0xA1: instructionIndirectXRead(&CPU::instructionLDA, A); break;   // LDA (Indirect,X)
+        case 0xA2: instructionImmediate(&CPU::instructionLDA, X); break;       // LDX Immediate
+        case 0xA4: instructionZeroPageRead(&CPU::instructionLDA, Y); break;    // LDY Zero Page
+        case 0xA5: instructionZeroPageRead(&CPU::instructionLDA, A); break;    // LDA Zero Page
+        case 0xA6: instructionZeroPageRead(&CPU::instructionLDA, X); break;    // LDX Zero Page
+        case 0xA8: instructionTransfer(&CPU::instructionLDA, Y, A); break;     // TAY
+        case 0xA9: instructionImmediate(&CPU::instructionLDA, A); break;       // LDA Immediate
+        case 0xAA: instructionTransfer(&CPU::instructionLDA, X, A); break;     // TAX
+        case 0xAC: instructionAbsoluteRead(&CPU::instructionLDA, Y); break;    // LDY Absolute
+        case 0xAD: instructionAbsoluteRead(&CPU::instructionLDA, A); break;    // LDA Absolute
+        case 0xAE: instructionAbsoluteRead(&CPU::instructionLDA, X); break;    // LDX Absolute
+        case 0xB0: instructionBranch(C); break;                                // BCS
+        case 0xB1: instructionIndirectYRead(&CPU::instructionLDA, A); break;   // LDA (Indirect),Y
+        case 0xB4: instructionZeroPageRead(&CPU::instructionLDA, Y, X); break; // LDY Zero Page,X
+        case 0xB5: instructionZeroPageRead(&CPU::instructionLDA, A, X); break; // LDA Zero Page,X
+        case 0xB6: instructionZeroPageRead(&CPU::instructionLDA, X, Y); break; // LDX Zero Page,Y
+        case 0xB8: instructionClear(V); break;                                 // CLV
+        case 0xB9: instructionAbsoluteRead(&CPU::instructionLDA, A, Y); break; // LDA Absolute,Y
+        case 0xBA: instructionTransfer(&CPU::instructionLDA, X, SP); break;    // TSX
+        case 0xBC: instructionAbsoluteRead(&CPU::instructionLDA, Y, X); break; // LDY Absolute,Y
+        case 0xBD: instructionAbsoluteRead(&CPU::instructionLDA, A, X); break; // LDA Absolute,X
+        case 0xBE: instructionAbsoluteRead(&CPU::instructionLDA, X, Y); break; // LDX Absolute,X
+        case 0xC0: instructionImmediate(&CPU::instructionCMP, Y); break;       // CPY Immediate
+        case 0xC1: instructionIndirectXRead(&CPU::instructionCMP, A); break;   // CMP (Indirect,X)
+        case 0xC4: instructionZeroPageRead(&CPU::instructionCMP, Y); break;    // CPY Zero Page
+        case 0xC5: instructionZeroPageRead(&CPU::instructionCMP, A); break;    // CMP Zero Page
+        case 0xC6: instructionZeroPageData(&CPU::instructionDEC); break;       // DEC Zero Page
+        case 0xC8: instructionImplied(&CPU::instructionINC, Y); break;         // INY
+        case 0xC9: instructionImmediate(&CPU::instructionCMP, A); break;       // CMP Immediate
+        case 0xCA: instructionImplied(&CPU::instructionDEC, X); break;         // DEX
+        case 0xCC: instructionAbsoluteRead(&CPU::instructionCMP, Y); break;    // CPY Absolute
+        case 0xCD: instructionAbsoluteRead(&CPU::instructionCMP, A); break;    // CMP Absolute
+        case 0xCE: instructionAbsoluteData(&CPU::instructionDEC); break;       // DEC Absolute
+        case 0xD0: instructionBranch(!Z); break;                               // BNE
+        case 0xD1: instructionIndirectYRead(&CPU::instructionCMP, A); break;   // CMP (Indirect),Y
+        case 0xD6: instructionZeroPageData(&CPU::instructionDEC, X); break;    // DEC Zero Page,X
+        case 0xD8: instructionClear(D); break;                                 // CLD
+        case 0xD9: instructionAbsoluteRead(&CPU::instructionCMP, A, Y); break; // CMP Absolute,Y
+        case 0xD5: instructionZeroPageRead(&CPU::instructionCMP, A, X); break; // CMP Zero Page,X
+        case 0xDD: instructionAbsoluteRead(&CPU::instructionCMP, A, X); break; // CMP Absolute,X
+        case 0xDE: instructionAbsoluteRead(&CPU::instructionDEC, X); break;    // DEC Absolute,X
+        case 0xE0: instructionImmediate(&CPU::instructionCMP, X); break;       // CPX Immediate
+        case 0xE1: instructionIndirectXRead(&CPU::instructionSBC, A); break;   // SBC (Indirect,X)
+        case 0xE4: instructionZeroPageRead(&CPU::instructionCMP, X); break;    // CPX Zero Page
+        case 0xE5: instructionZeroPageRead(&CPU::instructionSBC, A); break;    // SBC Zero Page
+        case 0xE6: instructionZeroPageData(&CPU::instructionINC); break;       // INC Zero Page
+        case 0xE8: instructionImplied(&CPU::instructionINC, X); break;         // INX
+        case 0xE9: instructionImmediate(&CPU::instructionSBC, A); break;       // SBC Immediate
+        case 0xEA: instructionNOP(); break;                                    // NOP
+        case 0xEC: instructionAbsoluteRead(&CPU::instructionCMP, X); break;    // CPX Absolute
+        case 0xED: instructionAbsoluteRead(&CPU::instructionSBC, A); break;    // SBC Absolute
+        case 0xEE: instructionAbsoluteData(&CPU::instructionINC); break;       // INC Absolute
+        case 0xF0: instructionBranch(Z); break;                                // BEQ
+        case 0xF1: instructionIndirectYRead(&CPU::instructionSBC, A); break;   // SBC (Indirect),Y
+        case 0xF5: instructionZeroPageRead(&CPU::instructionSBC, A, X); break; // SBC Zero Page,X
+        case 0xF6: instructionZeroPageData(&CPU::instructionINC, X); break;    // INC Zero Page,X
+        case 0xF8: instructionSet(D); break;                                   // SED
+        case 0xF9: instructionAbsoluteRead(&CPU::instructionSBC, A, Y); break; // SBC Absolute,Y
+        case 0xFD: instructionAbsoluteRead(&CPU::instructionSBC, A, X); break; // SBC Absolute,X
+        case 0xFE: instructionAbsoluteData(&CPU::instructionINC, X); break;    // INC Absolute,X
+        default:
+            // PC is left on the opcode and nothing is counted,
+            // so calling run() again doesn't retire it again
+            PC--;
+            cycles -= opcodeCycles[opcode];
+            instructions--;
+            stop = Stop::BadOpcode;
+    }
+}
+
+// opcodes that modify values
+constexpr auto CPU::instructionADC(byte data) -> byte
+{
+    // it's a word so we can detective if bit 9 is 1(Carry) or 0
+    byte temp = (C ? 1 : 0);
+    word res = A + data + temp;
+    // if A and data have 0(1) in their msb, then (A^data) = 0(1)
+    // and we want to know the opposite of it. So ~(A^data) = 1 if they had
+    // different sigs
+    // then we compare if res and A have the same msb
+    // and it will be 1 if they don't have the same sign
+    // and we AND it with ~(A ^ data) so it will be 1 if there was
+    // an overflow and 0 if not
+    // since we only care about the msb, we mask it with 0x80
+    V = (~(A ^ data) & (res ^ A) & (0x80));
+    N = res & 0x0080;
+    C = res & 0x0100;
+    Z = (res == 0);
+
+    return res;
+}
+
+constexpr auto CPU::instructionAND(byte data) -> byte
+{
+    byte res = data & A;
+
+    N = res & 0x80;
+    Z = (res == 0);
+
+    return res;
+}
+
+constexpr auto CPU::instructionASL(byte data) -> byte
+{
+    byte res = (data << 1);
+    Z = (res == 0);
+    N = res & 0x80;
+    C = data & 0x80;
+
+    return res;
+}
+
+constexpr auto CPU::instructionBIT(byte data) -> byte
+{
+    byte res = (A & data);
+    Z = (res == 0);
+    V = data & 0x40;
+    N = data & 0x80;
+
+    return A;
+}
+
+constexpr auto CPU::instructionCMP(byte data) -> byte
+{
+    word res = A - data;
+    C = res & 0x0100;
+    Z = (A == data);
+    N = res & 0x80;
+
+    return A;
+}
+
+constexpr auto CPU::instructionCMX(byte data) -> byte
+{
+    word res = X - data;
+    C = res & 0x0100;
+    Z = (X == data);
+    N = res & 0x80;
+
+    return X;
+}
+
+constexpr auto CPU::instructionCMY(byte data) -> byte
+{
+    word res = Y - data;
+    C = res & 0x0100;
+    Z = (Y == data);
+    N = res & 0x80;
+
+    return Y;
+}
+
+// can be used for DEX and DEY too
+constexpr auto CPU::instructionDEC(byte data) -> byte
+{
+    data--;
+    Z = (data == 0);
+    N = data & 0x80;
+
+    return data;
+}
+
+
+constexpr auto CPU::instructionEOR(byte data) -> byte
+{
+    byte res = A ^ data;
+    Z = (res == 0);
+    N = res & 0x80;
+
+    return res;
+}
+
+// can be used for INX and INY too
+constexpr auto CPU::instructionINC(byte data) -> byte
+{
+    data++;
+    Z = (data == 0);
+    N = data & 0x80;
+
+    return data;
+}
+
+// also works for LDX and LDY
+constexpr auto CPU::instructionLDA(byte data) -> byte
+{
+    Z = (data == 0);
+    N = data & 0x40;
+    return data;
+}
+
+constexpr auto CPU::instructionLSR(byte data) -> byte
+{
+    byte res = (data >> 1);
+    Z = (res == 0);
+    N = res & 0x80;
+    C = data & 0x01;
+
+    return res;
+}
+
+constexpr auto CPU::instructionORA(byte data) -> byte
+{
+    byte res = A | data;
+    Z = (res == 0);
+    N = res & 0x80;
+
+    return res;
+}
+
+constexpr auto CPU::instructionROL(byte data) -> byte
+{
+    byte res = (data << 1) | C;
+    Z = (res == 0);
+    N = res & 0x80;
+    C = data & 0x80;
+
+    return res;
+}
+
+constexpr auto CPU::instructionROR(byte data) -> byte
+{
+    byte temp = (C ? (1 << 7) : 0);
+    byte res = (data >> 1) | temp;
+    Z = (res == 0);
+    N = res & 0x80;
+    C = (data & 0x01);
+
+    return res;
+}
+
+constexpr auto CPU::instructionSBC(byte data) -> byte
+{
+    // same idea as in ADC, but converting data to ~data first
+    byte temp = (C ? 1 : 0);
+    data = ~data;
+    word res = A + data + temp;
+    V = (~(A ^ data) & (res ^ A) & (0x80)) >> 7;
+    N = res & 0x0080;
+    C = res & 0x0100;
+    Z = (res == 0);
+
+    return res;
+}
+
+// opcodes for the stack
+constexpr auto CPU::instructionPushA(void) -> void
+{
+    storeMemory(0x0100 | SP--, A);
+}
+
+constexpr auto CPU::instructionPullA(void) -> void
+{
+    A = loadMemory(0x0100 | ++SP);
+}
+
+constexpr auto CPU::instructionPushS(void) -> void
+{
+    storeMemory(0x0100 | SP--, statusRegister());
+}
+
+constexpr auto CPU::instructionPullS(void) -> void
+{
+    setStatusRegister(loadMemory(0x0100 | ++SP));
+}
+
+// opcode that does nothing
+constexpr auto CPU::instructionNOP(void) -> void
+{
+}
+
+// branch operations
+constexpr auto CPU::instructionBranch(bool decision) -> void
+{
+    if (decision) {
+        auto offset = static_cast<int8_t>(readMemory());
+        word dest = PC + offset;
+        recordEdge(PC - 2, dest);
+        // one more cycle if taken, two if it crosses a page
+        cycles += ((dest ^ PC) & 0xFF00) ? 2 : 1;
+        PC = dest;
+    } else {
+        readMemory();
+        // falling through is an edge too, or a fuzzer could not
+        // tell that a compare started to match
+        recordEdge(PC - 2, PC);
+    }
+}
+
+// jump operations
+constexpr auto CPU::instructionJumpAbsolute(void) -> void
+{
+    word dest = readMemory();
+    dest |= (readMemory() << 8);
+    recordEdge(PC - 3, dest);
+    PC = dest;
+}
+
+constexpr auto CPU::instructionJumpIndirect(void) -> void
+{
+    word addr = readMemory();
+    addr |= (readMemory() << 8);
+    byte loc = loadMemory(addr);
+    word dest = loc;
+    loc++; // so it wraps around in case of being 0xFF;
+           // See: https://www.nesdev.org/obelisk-6502-guide/reference.html#JMP
+    dest |= (loadMemory(loc) << 8);
+    recordEdge(PC - 3, dest);
+    PC = dest;
+}
+
+// jump to/from subroutines operations
+constexpr auto CPU::instructionJumpSubroutines(void) -> void
+{
+    word dest = readMemory();
+    dest |= (readMemory() << 8);
+    PC--; // so we can get to the position
+          // of the the the last readMemory above
+    pushPC();
+    recordEdge(PC - 2, dest);
+    PC = dest;
+}
+
+constexpr auto CPU::instructionFromSubroutines(void) -> void
+{
+    pullPC();
+    PC++; // so we can go to the next instruction
+          // after the last readMemory in instructionJumpSubroutines
+}
+
+// status instructions
+constexpr auto CPU::instructionClear(bool& status) -> void
+{
+    status = 0;
+}
+
+constexpr auto CPU::instructionSet(bool& status)   -> void
+{
+    status = 1;
+}
+
+
+
+
+// interrupt instructions
+constexpr auto CPU::instructionInterrupt(void) -> void
+{
+    interrupts++;
+    pushPC();
+    instructionPushS();
+    PC = loadMemory(0xFFFE);
+    PC |= (loadMemory(0xFFFF) << 8);
+}
+
+constexpr auto CPU::instructionReturnInter(void) -> void
+{
+    instructionPullS();
+    pullPC();
+
+}
+
+// addressing modes
+constexpr auto CPU::instructionImmediate(fp instr, byte& reg) -> void
+{
+    reg = (this->*instr)(readMemory());
+}
+
+
+constexpr auto CPU::instructionZeroPageRead(fp instr, byte& reg)  -> void
+{
+    auto zero = readMemory();
+    reg = (this->*instr)(loadMemory(zero));
+}
+
+constexpr auto CPU::instructionZeroPageRead(fp instr, byte& reg, byte& index) -> void
+{
+    auto zero = readMemory();
+    zero += index; // to avoid the sum be higher than 1 byte
+    reg = (this->*instr)(loadMemory(zero));
+}
+
+constexpr auto CPU::instructionAbsoluteRead(fp instr, byte& reg)  -> void
+{
+    word addr = readMemory();
+    addr |= (readMemory() << 8);
+
+    reg = (this->*instr)(loadMemory(addr));
+}
+
+constexpr auto CPU::instructionAbsoluteRead(fp instr, byte& reg, byte& index)  -> void
+{
+    word addr = readMemory();
+    addr |= (readMemory() << 8);
+    reg = (this->*instr)(loadMemory(addr + index));
+}
+
+constexpr auto CPU::instructionIndirectXRead(fp instr, byte& reg) -> void
+{
+    auto zero = readMemory();
+    word addr  = loadMemory(zero + X);
+    addr |= (loadMemory(zero + X + 1) << 8);
+
+    reg = (this->*instr)(loadMemory(addr));
+}
+
+constexpr auto CPU::instructionIndirectYRead(fp instr, byte& reg) -> void
+{
+    auto zero = readMemory();
+    word addr = loadMemory(zero);
+    addr |= (loadMemory(zero + 1) << 8);
+    reg = (this->*instr)(loadMemory(addr + Y));
+}
+
+constexpr auto CPU::instructionTransfer(fp instr, byte& to, byte& from) -> void
+{
+    to = (this->*instr)(from);
+}
+
+constexpr auto CPU::instructionImplied(fp instr, byte& data) -> void
+{
+    data = (this->*instr)(data);
+}
+
+constexpr auto CPU::instructionZeroPageStore(byte& reg)  -> void
+{
+    auto zero = readMemory();
+    storeMemory(zero, reg);
+}
+
+constexpr auto CPU::instructionZeroPageStore(byte& reg, byte& index)          -> void
+{
+    auto zero = readMemory();
+    zero += index;
+    storeMemory(zero, reg);
+
+}
+
+constexpr auto CPU::instructionAbsoluteStore(byte& reg)                       -> void
+{
+    word addr = readMemory();
+    addr |= (readMemory() << 8);
+    storeMemory(addr, reg);
+}
+
+constexpr auto CPU::instructionAbsoluteStore(byte& reg, byte& index)          -> void
+{
+    word addr = readMemory();
+    addr |= (readMemory() << 8);
+    storeMemory(addr + index, reg);
+}
+
+constexpr auto CPU::instructionIndirectXStore(byte& reg)                      -> void
+{
+    auto zero = readMemory();
+
+    word addr  = loadMemory(zero + X);
+    addr |= (loadMemory(zero + X + 1) << 8);
+    storeMemory(addr, reg);
+}
+
+constexpr auto CPU::instructionIndirectYStore(byte& reg)                      -> void
+{
+    auto zero = readMemory();
+    word addr = loadMemory(zero);
+    addr |= (loadMemory(zero + 1) << 8);
+
+    storeMemory(addr + Y, reg);
+}
+
+constexpr auto CPU::instructionZeroPageData(fp instr)                         -> void
+{
+    auto zero = readMemory();
+    storeMemory(zero, (this->*instr)(loadMemory(zero)));
+}
+
+constexpr auto CPU::instructionZeroPageData(fp instr, byte& index)            -> void
+{
+    auto zero = readMemory();
+    zero += index;
+    storeMemory(zero, (this->*instr)(loadMemory(zero)));
+}
+
+constexpr auto CPU::instructionAbsoluteData(fp instr)                         -> void
+{
+    word addr = readMemory();
+    addr |= (readMemory() << 8);
+    storeMemory(addr, (this->*instr)(loadMemory(addr)));
+}
+
+constexpr auto CPU::instructionAbsoluteData(fp instr, byte& index)           -> void
+{
+    word addr = readMemory();
+    addr |= (readMemory() << 8);
+    addr += index;
+    storeMemory(addr, (this->*instr)(loadMemory(addr)));
+}
+
+constexpr auto CPU::instructionIndirectXData(fp instr)                        -> void
+{
+    auto zero = readMemory();
+    word addr = loadMemory(zero + X);
+    addr |= (loadMemory(zero + X +  1) << 8);
+    storeMemory(addr, (this->*instr)(loadMemory(addr)));
+}
+
+constexpr auto CPU::instructionIndirectYData(fp instr)                        -> void
+{
+    auto zero = readMemory();
+    word addr = loadMemory(zero);
+    addr |= (loadMemory(zero + 1) << 8);
+    addr += Y;
+    storeMemory(addr, (this->*instr)(loadMemory(addr)));
+}
+
+// coverage
+constexpr auto CPU::recordEdge(word from, word to) -> void
+{
+    if (!coverage)
+        return;
+    auto edge = static_cast<word>((from >> 1) ^ to);
+    if (coverage[edge] == 0 && edges)
+        edges[edgeCount++] = edge;
+    if (coverage[edge] != 0xFF)
+        coverage[edge]++;
+}
+
+// Stack PC operations
+constexpr auto CPU::pushPC(void) -> void
+{
+    storeMemory(0x0100 | SP--, (PC >> 8));
+    storeMemory(0x0100 | SP--, PC);
+}
+
+constexpr auto CPU::pullPC(void) -> void
+{
+    PC = loadMemory(0x0100 | ++SP);
+    PC |= (loadMemory(0x0100 | ++SP) << 8);
+}
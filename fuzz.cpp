@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cstring>
+#include "fuzz.hpp"
+
+auto Fuzzer::setup(const CPU& initial) -> void
+{
+    snapshot = initial;
+    snapshot.metrics = nullptr;
+    snapshot.coverage = nullptr;
+    snapshot.edges = nullptr;
+    snapshot.edgeCount = 0;
+    memset(snapshot.dirty, 0, sizeof(snapshot.dirty));
+
+    byte* coverage = cpu.coverage;
+    word* edges = cpu.edges;
+    Metrics* metrics = cpu.metrics;
+    cpu = snapshot;
+    cpu.coverage = coverage;
+    cpu.edges = edges;
+    cpu.metrics = metrics;
+}
+
+auto Fuzzer::addRegion(word addr, uint32_t size) -> void
+{
+    regions.push_back({addr, size});
+}
+
+auto Fuzzer::runCase(const byte* data, size_t size) -> CPU::Stop
+{
+    for (auto& region : regions) {
+        auto len = static_cast<uint32_t>(std::min<size_t>(size, region.size));
+        cpu.loadImage(data, len, region.addr);
+        data += len;
+        size -= len;
+    }
+
+    cpu.step(budget);
+    auto stop = cpu.stop;
+    restore();
+
+    return stop;
+}
+
+auto Fuzzer::restore(void) -> void
+{
+    for (uint32_t page = 0; page < CPU::pages; page++) {
+        if (!cpu.dirty[page])
+            continue;
+        memcpy(cpu.mem.ram + page * 0x100, snapshot.mem.ram + page * 0x100, 0x100);
+        cpu.dirty[page] = 0;
+    }
+
+    cpu.PC = snapshot.PC;
+    cpu.SP = snapshot.SP;
+    cpu.A = snapshot.A;
+    cpu.X = snapshot.X;
+    cpu.Y = snapshot.Y;
+    cpu.C = snapshot.C;
+    cpu.Z = snapshot.Z;
+    cpu.I = snapshot.I;
+    cpu.D = snapshot.D;
+    cpu.V = snapshot.V;
+    cpu.N = snapshot.N;
+    // cycles, instructions and interrupts keep counting across cases,
+    // so metrics show the whole session
+    cpu.effects = snapshot.effects;
+    cpu.writeHash = snapshot.writeHash;
+    cpu.stop = snapshot.stop;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "cpu.hpp"
+
+// runs one input per case from a fixed starting state. Input bytes are
+// copied into the regions in order, the CPU runs at most budget
+// instructions, then only the pages it dirtied are restored.
+// The cycle, instruction and interrupt counters are not restored
+class Fuzzer
+{
+public:
+    struct Region
+    {
+        word addr;
+        uint32_t size;
+    };
+
+    // the state every case starts from
+    auto setup(const CPU& initial)                 -> void;
+    auto addRegion(word addr, uint32_t size)       -> void;
+    auto runCase(const byte* data, size_t size)    -> CPU::Stop;
+    auto restore(void)                             -> void;
+
+    std::vector<Region> regions;
+    uint64_t budget{10000};
+
+    CPU cpu;
+    CPU snapshot;
+};
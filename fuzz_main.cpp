@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "fuzz.hpp"
+#include "metrics.hpp"
+
+// Standalone:
+//   6502fuzz image load-addr entry addr:size... [-b budget] [-n runs] [-s seed] [-m metrics]
+// libFuzzer (built with SIM6502_LIBFUZZER), configured from the environment:
+//   SIM6502_IMAGE, SIM6502_LOAD, SIM6502_ENTRY, SIM6502_REGIONS (addr:size,...),
+//   SIM6502_BUDGET, SIM6502_METRICS
+// A case that hits an unknown opcode is reported as a crash.
+
+static Fuzzer fuzzer;
+static Metrics metrics;
+
+#ifdef SIM6502_LIBFUZZER
+// libFuzzer reads these like its own coverage counters
+__attribute__((used, section("__libfuzzer_extra_counters")))
+#endif
+static byte coverage[CPU::coverageSize];
+
+static auto number(const char* text) -> uint32_t
+{
+    return static_cast<uint32_t>(strtoul(text, nullptr, 0));
+}
+
+static auto configure(const char* image, const char* load, const char* entry) -> bool
+{
+    static CPU initial{};
+    if (!initial.loadFile(image, number(load))) {
+        std::cerr << "Can't read image: " << image << "\n";
+        return false;
+    }
+    initial.SP = 0xFF;
+    initial.I = 1;
+    initial.PC = number(entry);
+    fuzzer.cpu.coverage = coverage;
+    fuzzer.setup(initial);
+    return true;
+}
+
+static auto publishTo(const char* path) -> bool
+{
+    if (!metrics.create(path)) {
+        std::cerr << "Can't create metrics: " << path << "\n";
+        return false;
+    }
+    fuzzer.cpu.metrics = &metrics;
+    return true;
+}
+
+// "addr:size"
+static auto addRegion(const std::string& text) -> bool
+{
+    auto colon = text.find(':');
+    if (colon == std::string::npos) {
+        std::cerr << "Bad region: " << text << "\n";
+        return false;
+    }
+    fuzzer.addRegion(number(text.substr(0, colon).c_str()), number(text.substr(colon + 1).c_str()));
+    return true;
+}
+
+#ifdef SIM6502_LIBFUZZER
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+    auto image = getenv("SIM6502_IMAGE");
+    auto load = getenv("SIM6502_LOAD");
+    auto entry = getenv("SIM6502_ENTRY");
+    auto regions = getenv("SIM6502_REGIONS");
+    if (!image || !load || !entry || !regions) {
+        std::cerr << "Set SIM6502_IMAGE, SIM6502_LOAD, SIM6502_ENTRY and SIM6502_REGIONS\n";
+        exit(EXIT_FAILURE);
+    }
+    if (!configure(image, load, entry))
+        exit(EXIT_FAILURE);
+
+    std::string list{regions};
+    for (size_t first = 0; first < list.size();) {
+        auto comma = std::min(list.find(',', first), list.size());
+        if (!addRegion(list.substr(first, comma - first)))
+            exit(EXIT_FAILURE);
+        first = comma + 1;
+    }
+    if (auto budget = getenv("SIM6502_BUDGET"))
+        fuzzer.budget = number(budget);
+    if (auto path = getenv("SIM6502_METRICS")) {
+        if (!publishTo(path))
+            exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (fuzzer.runCase(data, size) == CPU::Stop::BadOpcode)
+        abort();
+
+    return 0;
+}
+
+#else
+
+// AFL style hit count classes, so loops that run a few more times
+// still count as new behaviour
+static auto bucket(byte hits) -> byte
+{
+    if (hits < 4)   return hits == 3 ? 4 : hits;
+    if (hits < 8)   return 8;
+    if (hits < 16)  return 16;
+    if (hits < 32)  return 32;
+    if (hits < 128) return 64;
+    return 128;
+}
+
+static byte seen[CPU::coverageSize];
+
+static word edges[CPU::coverageSize];
+
+// checks and clears only the edges this case touched
+static auto newCoverage(void) -> bool
+{
+    bool found = false;
+    for (uint32_t i = 0; i < fuzzer.cpu.edgeCount; i++) {
+        auto edge = edges[i];
+        byte hit = bucket(coverage[edge]);
+        if (hit & ~seen[edge]) {
+            seen[edge] |= hit;
+            found = true;
+        }
+        coverage[edge] = 0;
+    }
+    fuzzer.cpu.edgeCount = 0;
+    return found;
+}
+
+static auto mutate(std::vector<byte>& input, const std::vector<std::vector<byte>>& corpus,
+                   size_t maxSize, std::mt19937_64& rng) -> void
+{
+    constexpr byte interesting[] = {0x00, 0x01, 0x7F, 0x80, 0xFF};
+    auto rounds = 1 + rng() % 4;
+    for (size_t round = 0; round < rounds; round++) {
+        auto pos = input.empty() ? 0 : rng() % input.size();
+        switch (rng() % 6) {
+            case 0:
+                if (!input.empty())
+                    input[pos] ^= 1 << (rng() % 8);
+                break;
+            case 1:
+                if (!input.empty())
+                    input[pos] = rng();
+                break;
+            case 2:
+                if (!input.empty())
+                    input[pos] = interesting[rng() % sizeof(interesting)];
+                break;
+            case 3:
+                if (input.size() < maxSize)
+                    input.insert(input.begin() + pos, static_cast<byte>(rng()));
+                break;
+            case 4:
+                if (!input.empty())
+                    input.erase(input.begin() + pos);
+                break;
+            case 5: {
+                auto& other = corpus[rng() % corpus.size()];
+                if (other.empty() || input.empty())
+                    break;
+                auto from = rng() % other.size();
+                auto len = std::min({other.size() - from, input.size() - pos, static_cast<size_t>(1 + rng() % 16)});
+                std::copy_n(other.begin() + from, len, input.begin() + pos);
+                break;
+            }
+        }
+    }
+}
+
+int main(int argc, char* args[])
+{
+    uint64_t runs = UINT64_MAX;
+    uint64_t seed = 0;
+    const char* metricsPath = nullptr;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(args[i], "-b") == 0)
+            fuzzer.budget = strtoull(args[++i], nullptr, 0);
+        else if (i + 1 < argc && strcmp(args[i], "-n") == 0)
+            runs = strtoull(args[++i], nullptr, 0);
+        else if (i + 1 < argc && strcmp(args[i], "-s") == 0)
+            seed = strtoull(args[++i], nullptr, 0);
+        else if (i + 1 < argc && strcmp(args[i], "-m") == 0)
+            metricsPath = args[++i];
+        else
+            positional.push_back(args[i]);
+    }
+    if (positional.size() < 4) {
+        std::cerr << "usage: " << args[0]
+                  << " image load-addr entry addr:size... [-b budget] [-n runs] [-s seed] [-m metrics]\n";
+        return EXIT_FAILURE;
+    }
+    if (!configure(positional[0].c_str(), positional[1].c_str(), positional[2].c_str()))
+        return EXIT_FAILURE;
+    fuzzer.cpu.edges = edges;
+    if (metricsPath && !publishTo(metricsPath))
+        return EXIT_FAILURE;
+    size_t maxSize = 0;
+    for (size_t i = 3; i < positional.size(); i++) {
+        if (!addRegion(positional[i]))
+            return EXIT_FAILURE;
+        maxSize += fuzzer.regions.back().size;
+    }
+
+    std::mt19937_64 rng{seed};
+    std::vector<std::vector<byte>> corpus{{}, std::vector<byte>(maxSize, 0)};
+    uint64_t crashes = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto report = start;
+
+    for (uint64_t run = 0; run < runs; run++) {
+        auto input = corpus[rng() % corpus.size()];
+        mutate(input, corpus, maxSize, rng);
+
+        auto stop = fuzzer.runCase(input.data(), input.size());
+        bool found = newCoverage();
+
+        if (stop == CPU::Stop::BadOpcode) {
+            // only crashes on new paths are kept
+            if (found) {
+                auto name = "crash-" + std::to_string(crashes++);
+                std::ofstream(name, std::ios::binary).write(reinterpret_cast<const char*>(input.data()), input.size());
+                std::cout << "crash written to " << name << "\n";
+            }
+        } else if (found) {
+            corpus.push_back(std::move(input));
+        }
+
+        if ((run & 0xFFF) == 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - report >= std::chrono::seconds(1) || run + 1 >= runs) {
+                report = now;
+                double seconds = std::chrono::duration<double>(now - start).count();
+                std::cout << "runs: " << run + 1 << "  exec/s: " << static_cast<uint64_t>((run + 1) / seconds)
+                          << "  corpus: " << corpus.size() << "  crashes: " << crashes << "\n";
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "done, runs: " << runs << "  exec/s: " << static_cast<uint64_t>(runs / seconds)
+              << "  corpus: " << corpus.size() << "  crashes: " << crashes << "\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include "lockstep.hpp"
+#include "memview.hpp"
+
+auto Lockstep::reference(CPU& cpu, uint64_t count) -> void
+{
+    cpu.stop = CPU::Stop::Running;
+    for (uint64_t i = 0; i < count && cpu.stop == CPU::Stop::Running; i++) {
+        cpu.instruction();
+        if (cpu.stop == CPU::Stop::Running && cpu.watch && !cpu.watch(cpu.watchUser, cpu))
+            break;
+    }
+    if (cpu.stop == CPU::Stop::Running)
+        cpu.stop = CPU::Stop::Until;
+}
+
+auto Lockstep::fast(CPU& cpu, uint64_t count) -> void
+{
+    cpu.step(count);
+}
+
+auto Lockstep::run(CPU& a, CPU& b, uint64_t count) -> bool
+{
+    report.clear();
+    if (!compare(a, b))
+        return false;
+    // whole copies once, after that only what changed between checks
+    if (every > 1) {
+        savedA = std::make_unique<CPU>(a);
+        savedB = std::make_unique<CPU>(b);
+        memset(a.dirty, 0, sizeof(a.dirty));
+        memset(b.dirty, 0, sizeof(b.dirty));
+    }
+
+    for (uint64_t done = 0; done < count;) {
+        auto chunk = std::min(every, count - done);
+        engineA(a, chunk);
+        engineB(b, chunk);
+        if (!compare(a, b)) {
+            if (every == 1)
+                return false;
+            rewind(a, b);
+            return replay(a, b, chunk);
+        }
+        if (every > 1) {
+            copyChanged(*savedA, a, a.dirty);
+            copyChanged(*savedB, b, b.dirty);
+        }
+
+        done += chunk;
+        if (a.stop == CPU::Stop::BadOpcode)
+            break;
+    }
+
+    return true;
+}
+
+auto Lockstep::replay(CPU& a, CPU& b, uint64_t count) -> bool
+{
+    uint64_t start = a.instructions;
+    Follower follower{this, &a, 0, false};
+    b.watch = follow;
+    b.watchUser = &follower;
+    engineB(b, count);
+    b.watch = nullptr;
+    b.watchUser = nullptr;
+    if (follower.diverged)
+        return false;
+
+    if (!follower.events && b.instructions != start) {
+        // engine b does not call the watcher
+        rewind(a, b);
+        return replayStepped(a, b, count);
+    }
+
+    // b stopped without a mismatch on the way, so compare where it
+    // stopped and then where a would have
+    if (b.instructions > a.instructions)
+        engineA(a, b.instructions - a.instructions);
+    if (!compare(a, b))
+        return false;
+    if (a.stop != CPU::Stop::BadOpcode && start + count > a.instructions) {
+        engineA(a, start + count - a.instructions);
+        if (!compare(a, b))
+            return false;
+    }
+
+    report = "engines diverged over " + std::to_string(count) +
+        " instructions but agree when replayed\n";
+    return false;
+}
+
+auto Lockstep::follow(void* user, CPU& b) -> bool
+{
+    auto& follower = *static_cast<Follower*>(user);
+    auto& a = *follower.a;
+    follower.events++;
+    // after a skipped idle loop a has many instructions to catch up
+    uint64_t behind = b.instructions > a.instructions ? b.instructions - a.instructions : 0;
+    if (behind)
+        follower.lockstep->engineA(a, behind);
+    if (follower.lockstep->compare(a, b, true))
+        return true;
+
+    if (behind > 1)
+        follower.lockstep->report += "  b skipped an idle loop from instruction " +
+            std::to_string(b.instructions - behind) + "\n";
+    follower.diverged = true;
+    return false;
+}
+
+auto Lockstep::replayStepped(CPU& a, CPU& b, uint64_t count) -> bool
+{
+    for (uint64_t i = 0; i < count; i++) {
+        engineA(a, 1);
+        engineB(b, 1);
+        if (!compare(a, b))
+            return false;
+    }
+
+    // the divergence did not reproduce one instruction at a time
+    report = "engines diverged over " + std::to_string(count) +
+        " instructions but agree when stepped one by one\n";
+    return false;
+}
+
+auto Lockstep::rewind(CPU& a, CPU& b) -> void
+{
+    copyChanged(a, *savedA, a.dirty);
+    copyChanged(b, *savedB, b.dirty);
+}
+
+// the dirty pages and registers, like Fuzzer::restore, plus the
+// counters a comparison looks at
+auto Lockstep::copyChanged(CPU& to, const CPU& from, byte* dirty) -> void
+{
+    for (uint32_t page = 0; page < CPU::pages; page++) {
+        if (!dirty[page])
+            continue;
+        memcpy(to.mem.ram + page * 0x100, from.mem.ram + page * 0x100, 0x100);
+        dirty[page] = 0;
+    }
+
+    to.PC = from.PC;
+    to.SP = from.SP;
+    to.A = from.A;
+    to.X = from.X;
+    to.Y = from.Y;
+    to.C = from.C;
+    to.Z = from.Z;
+    to.I = from.I;
+    to.D = from.D;
+    to.V = from.V;
+    to.N = from.N;
+    to.cycles = from.cycles;
+    to.instructions = from.instructions;
+    to.effects = from.effects;
+    to.interrupts = from.interrupts;
+    to.writeHash = from.writeHash;
+    to.stop = from.stop;
+}
+
+auto Lockstep::compare(const CPU& a, const CPU& b, bool running) -> bool
+{
+    // b is still running when followed, only a bad opcode counts then
+    auto stopA = running ? a.stop == CPU::Stop::BadOpcode : static_cast<uint64_t>(a.stop);
+    auto stopB = running ? b.stop == CPU::Stop::BadOpcode : static_cast<uint64_t>(b.stop);
+    // runs after every check, so the common case stays plain compares
+    if (a.PC == b.PC && a.SP == b.SP && a.A == b.A && a.X == b.X && a.Y == b.Y &&
+        a.statusRegister() == b.statusRegister() && a.cycles == b.cycles &&
+        a.instructions == b.instructions && stopA == stopB && a.writeHash == b.writeHash)
+        return true;
+
+    std::ostringstream out;
+    auto check = [&](const char* name, uint64_t x, uint64_t y) {
+        if (x != y)
+            out << "  " << name << ": " << std::hex << x << " != " << y << std::dec << "\n";
+    };
+
+    check("PC", a.PC, b.PC);
+    check("SP", a.SP, b.SP);
+    check("A", a.A, b.A);
+    check("X", a.X, b.X);
+    check("Y", a.Y, b.Y);
+    check("P", a.statusRegister(), b.statusRegister());
+    check("cycles", a.cycles, b.cycles);
+    check("instructions", a.instructions, b.instructions);
+    check(running ? "bad opcode" : "stop", stopA, stopB);
+    check("write hash", a.writeHash, b.writeHash);
+    auto fields = out.str();
+
+    divergedAt = a.instructions;
+    out.str("");
+    out << "diverged at instruction " << divergedAt << "\n" << fields;
+    // only now is a full memory compare worth it
+    auto ranges = diffMemory(a.mem, b.mem);
+    if (!ranges.empty())
+        out << "  memory " << std::hex << ranges[0].first << "-" << ranges[0].last - 1 << " differs\n";
+    report = out.str();
+    return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "cpu.hpp"
+
+// runs two engines on their own CPU from the same state and compares
+// registers, flags, counters and the hash of memory writes every
+// `every` instructions. On a mismatch both are rewound to the last
+// agreeing check and b reruns the chunk in one call, skipping the same
+// idle loops, while a follows it instruction by instruction. The report
+// names the first instruction that diverged, or the idle loop b skipped.
+// Only pages marked dirty are saved between checks, so both CPUs have
+// their dirty flags cleared
+class Lockstep
+{
+public:
+    // runs count instructions on cpu
+    using Engine = auto (*)(CPU& cpu, uint64_t count) -> void;
+
+    // CPU::instruction() one at a time
+    static auto reference(CPU& cpu, uint64_t count) -> void;
+    // CPU::step(), with idle loop skipping
+    static auto fast(CPU& cpu, uint64_t count) -> void;
+
+    // true if a and b agreed for count instructions
+    auto run(CPU& a, CPU& b, uint64_t count) -> bool;
+
+    Engine engineA{reference};
+    Engine engineB{fast};
+    uint64_t every{1024};
+
+    // filled on divergence
+    uint64_t divergedAt{0}; // instructions retired by a when found
+    std::string report;
+
+private:
+    // a following b during a replay
+    struct Follower
+    {
+        Lockstep* lockstep;
+        CPU* a;
+        uint64_t events;
+        bool diverged;
+    };
+
+    auto compare(const CPU& a, const CPU& b, bool running = false) -> bool;
+    auto replay(CPU& a, CPU& b, uint64_t count) -> bool;
+    auto replayStepped(CPU& a, CPU& b, uint64_t count) -> bool;
+    auto rewind(CPU& a, CPU& b) -> void;
+    // copies what changed since the last check and clears dirty
+    static auto copyChanged(CPU& to, const CPU& from, byte* dirty) -> void;
+    static auto follow(void* user, CPU& b) -> bool;
+
+    std::unique_ptr<CPU> savedA;
+    std::unique_ptr<CPU> savedB;
+};
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "lockstep.hpp"
+#include "metrics.hpp"
+
+// 6502diff image load-addr entry instructions [-e every] [-m metrics]
+// runs the reference interpreter and CPU::step side by side, checking
+// every 1024 instructions unless -e says otherwise. Metrics are
+// published for the CPU::step side
+int main(int argc, char* args[])
+{
+    Lockstep lockstep;
+    Metrics metrics;
+    const char* metricsPath = nullptr;
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(args[i], "-e") == 0)
+            lockstep.every = std::max(1ull, strtoull(args[++i], nullptr, 0));
+        else if (i + 1 < argc && strcmp(args[i], "-m") == 0)
+            metricsPath = args[++i];
+        else
+            positional.push_back(args[i]);
+    }
+    if (positional.size() != 4) {
+        std::cerr << "usage: " << args[0] << " image load-addr entry instructions [-e every] [-m metrics]\n";
+        return EXIT_FAILURE;
+    }
+
+    auto a = std::make_unique<CPU>();
+    if (!a->loadFile(positional[0], strtoul(positional[1], nullptr, 0))) {
+        std::cerr << "Can't read image: " << positional[0] << "\n";
+        return EXIT_FAILURE;
+    }
+    a->SP = 0xFF;
+    a->I = 1;
+    a->PC = strtoul(positional[2], nullptr, 0);
+    auto b = std::make_unique<CPU>(*a);
+    if (metricsPath) {
+        if (!metrics.create(metricsPath)) {
+            std::cerr << "Can't create metrics: " << metricsPath << "\n";
+            return EXIT_FAILURE;
+        }
+        b->metrics = &metrics;
+    }
+
+    if (!lockstep.run(*a, *b, strtoull(positional[3], nullptr, 0))) {
+        std::cout << lockstep.report;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "engines agree for " << a->instructions << " instructions, "
+              << a->cycles << " cycles\n";
+    return 0;
+}
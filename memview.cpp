@@ -0,0 +1,123 @@
+#include <cstring>
+#include "memview.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// bit i of the result is set if a[i] != b[i]
+static auto diffBlock(const byte* a, const byte* b) -> uint32_t
+{
+#if defined(__AVX2__)
+    auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+#elif defined(__SSE2__)
+    uint32_t equal = 0;
+    for (int half = 0; half < 2; half++) {
+        auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + half * 16));
+        auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + half * 16));
+        equal |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) << (half * 16);
+    }
+    return ~equal;
+#else
+    uint32_t res = 0;
+    for (int i = 0; i < 32; i += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        if (wa == wb)
+            continue;
+        for (int j = 0; j < 8; j++)
+            res |= static_cast<uint32_t>(a[i + j] != b[i + j]) << (i + j);
+    }
+    return res;
+#endif
+}
+
+auto diffMemory(const byte* a, const byte* b, uint32_t size) -> std::vector<MemoryRange>
+{
+    std::vector<MemoryRange> ranges;
+    bool open = false;
+    uint32_t first = 0;
+
+    auto mark = [&](uint32_t addr, bool differs) {
+        if (differs && !open) {
+            first = addr;
+            open = true;
+        } else if (!differs && open) {
+            ranges.push_back({first, addr});
+            open = false;
+        }
+    };
+
+    uint32_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint32_t bits = diffBlock(a + i, b + i);
+        // whole block equal or whole block different, nothing to split
+        if (bits == 0 || bits == 0xFFFFFFFF) {
+            mark(i, bits != 0);
+            continue;
+        }
+        for (uint32_t j = 0; j < 32; j++)
+            mark(i + j, (bits >> j) & 1);
+    }
+    for (; i < size; i++)
+        mark(i, a[i] != b[i]);
+    if (open)
+        ranges.push_back({first, size});
+
+    return ranges;
+}
+
+auto diffMemory(const CPU::Memory& a, const CPU::Memory& b) -> std::vector<MemoryRange>
+{
+    return diffMemory(a.ram, b.ram, CPU::Memory::size);
+}
+
+auto hexDump(std::string& out, const byte* data, uint32_t first, uint32_t last) -> void
+{
+    constexpr char digits[] = "0123456789abcdef";
+    // "ffff: " + 16 * "xx " + " |" + 16 chars + "|\n"
+    constexpr size_t width = 6 + 16 * 3 + 2 + 16 + 2;
+
+    if (first >= last)
+        return;
+
+    out.reserve(out.size() + ((last - first) / 16 + 2) * width);
+    for (uint32_t line = first & ~0xFu; line < last; line += 16) {
+        char buf[width];
+        char* hex = buf;
+        char* text = buf + 6 + 16 * 3 + 2;
+
+        for (int shift = 12; shift >= 0; shift -= 4)
+            *hex++ = digits[(line >> shift) & 0xF];
+        *hex++ = ':';
+        *hex++ = ' ';
+        for (uint32_t addr = line; addr < line + 16; addr++) {
+            if (addr < first || addr >= last) {
+                hex[0] = hex[1] = ' ';
+                *text++ = ' ';
+            } else {
+                byte value = data[addr];
+                hex[0] = digits[value >> 4];
+                hex[1] = digits[value & 0xF];
+                *text++ = (value >= 0x20 && value < 0x7F) ? value : '.';
+            }
+            hex[2] = ' ';
+            hex += 3;
+        }
+        hex[0] = ' ';
+        hex[1] = '|';
+        text[0] = '|';
+        text[1] = '\n';
+        out.append(buf, width);
+    }
+}
+
+auto hexDump(std::ostream& out, const byte* data, uint32_t first, uint32_t last) -> void
+{
+    std::string buf;
+    hexDump(buf, data, first, last);
+    out.write(buf.data(), buf.size());
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+
+// changed bytes are [first, last)
+struct MemoryRange
+{
+    uint32_t first;
+    uint32_t last;
+};
+
+// compares two memory images and returns the ranges that differ
+auto diffMemory(const byte* a, const byte* b, uint32_t size)      -> std::vector<MemoryRange>;
+auto diffMemory(const CPU::Memory& a, const CPU::Memory& b)        -> std::vector<MemoryRange>;
+
+// hex and ASCII dump of [first, last), 16 bytes per line.
+// Lines are built in a buffer and written whole
+auto hexDump(std::string& out, const byte* data, uint32_t first, uint32_t last)   -> void;
+auto hexDump(std::ostream& out, const byte* data, uint32_t first, uint32_t last)  -> void;
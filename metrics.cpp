@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <new>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "metrics.hpp"
+
+Metrics::~Metrics()
+{
+    close();
+}
+
+auto Metrics::create(const char* path) -> bool
+{
+    close();
+    // built under a temporary name and renamed into place, so a reader
+    // that still maps an old file at path never sees it shrink
+    auto temp = std::string(path) + ".tmp." + std::to_string(getpid());
+    int fd = open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, sizeof(MetricsBlock)) == 0)
+        addr = mmap(nullptr, sizeof(MetricsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        unlink(temp.c_str());
+        return false;
+    }
+
+    block = new (addr) MetricsBlock{};
+    block->fileVersion = MetricsBlock::version;
+    block->fileMagic = MetricsBlock::magic;
+    begin();
+    if (rename(temp.c_str(), path) != 0) {
+        close();
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+auto Metrics::attach(const char* path) -> bool
+{
+    close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    // mapping past the end of a short file faults on first read
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(MetricsBlock))) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, sizeof(MetricsBlock), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+    inode = info.st_ino;
+
+    block = static_cast<MetricsBlock*>(addr);
+    if (block->fileMagic != MetricsBlock::magic || block->fileVersion != MetricsBlock::version) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+auto Metrics::replaced(const char* path) const -> bool
+{
+    struct stat info;
+    return stat(path, &info) == 0 && info.st_ino != inode;
+}
+
+auto Metrics::close(void) -> void
+{
+    if (block)
+        munmap(block, sizeof(MetricsBlock));
+    block = nullptr;
+}
+
+auto Metrics::begin(void) -> void
+{
+    last = std::chrono::steady_clock::now();
+}
+
+auto Metrics::publish(const CPU& cpu) -> void
+{
+    if (!block)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+    last = now;
+
+    constexpr auto relaxed = std::memory_order_relaxed;
+    block->instructions.store(cpu.instructions, relaxed);
+    block->cycles.store(cpu.cycles, relaxed);
+    block->interrupts.store(cpu.interrupts, relaxed);
+    block->hostNs.fetch_add(ns, relaxed);
+    block->PC.store(cpu.PC, relaxed);
+    block->stop.store(static_cast<uint32_t>(cpu.stop), relaxed);
+    block->updates.fetch_add(1, relaxed);
+}
+
+auto Metrics::stopName(uint32_t stop) -> const char*
+{
+    switch (static_cast<CPU::Stop>(stop)) {
+        case CPU::Stop::Running:   return "running";
+        case CPU::Stop::Until:     return "until";
+        case CPU::Stop::BadOpcode: return "bad-opcode";
+    }
+    return "unknown";
+}
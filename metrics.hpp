@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "cpu.hpp"
+
+// layout of the memory-mapped metrics file, written by a running CPU
+// with relaxed atomics so readers never slow it down
+struct MetricsBlock
+{
+    constexpr static uint32_t magic{0x32303536}; // "6502"
+    constexpr static uint32_t version{1};
+
+    uint32_t fileMagic;
+    uint32_t fileVersion;
+
+    std::atomic<uint64_t> instructions;
+    std::atomic<uint64_t> cycles;
+    std::atomic<uint64_t> interrupts;
+    std::atomic<uint64_t> hostNs;  // host time spent inside CPU::run
+    std::atomic<uint64_t> updates; // times the block was published
+    std::atomic<uint32_t> PC;
+    std::atomic<uint32_t> stop;    // a CPU::Stop
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+class Metrics
+{
+public:
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    auto operator=(const Metrics&) -> Metrics& = delete;
+    ~Metrics();
+
+    // writer side, creates or truncates the file
+    auto create(const char* path) -> bool;
+    // reader side, maps an existing file read only
+    auto attach(const char* path)         -> bool;
+    // true once create() has put a new file at the attached path
+    auto replaced(const char* path) const -> bool;
+    auto close(void)                      -> void;
+
+    auto begin(void)                -> void;
+    auto publish(const CPU& cpu)    -> void;
+
+    static auto stopName(uint32_t stop) -> const char*;
+
+    MetricsBlock* block{nullptr};
+    uint64_t interval{1 << 16}; // instructions between publishes
+
+private:
+    std::chrono::steady_clock::time_point last;
+    uint64_t inode{};
+};
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "metrics.hpp"
+
+// 6502stat [-w milliseconds] file...
+// prints the metrics of every running CPU, once or every milliseconds.
+// A simulator that restarts replaces its file, which is then reattached
+int main(int argc, char* args[])
+{
+    long wait = 0;
+    int first = 1;
+    if (argc > 2 && strcmp(args[1], "-w") == 0) {
+        wait = strtol(args[2], nullptr, 10);
+        first = 3;
+    }
+    if (first >= argc) {
+        std::cerr << "usage: " << args[0] << " [-w milliseconds] file...\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Metrics> files(argc - first);
+    for (int i = first; i < argc; i++) {
+        if (!files[i - first].attach(args[i])) {
+            std::cerr << "Can't read metrics: " << args[i] << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    constexpr auto relaxed = std::memory_order_relaxed;
+    do {
+        std::cout << std::left << std::setw(24) << "file"
+                  << std::right << std::setw(16) << "instructions"
+                  << std::setw(16) << "cycles"
+                  << std::setw(6) << "PC"
+                  << std::setw(12) << "interrupts"
+                  << std::setw(12) << "stop"
+                  << std::setw(10) << "ns/instr" << "\n";
+        for (size_t i = 0; i < files.size(); i++) {
+            auto path = args[first + i];
+            if (files[i].replaced(path))
+                files[i].attach(path);
+            auto block = files[i].block;
+            if (!block) {
+                std::cout << std::left << std::setw(24) << path << std::right << "  not readable\n";
+                continue;
+            }
+            auto instructions = block->instructions.load(relaxed);
+            auto ns = block->hostNs.load(relaxed);
+            std::cout << std::left << std::setw(24) << path
+                      << std::right << std::dec
+                      << std::setw(16) << instructions
+                      << std::setw(16) << block->cycles.load(relaxed)
+                      << std::setw(6) << std::hex << block->PC.load(relaxed) << std::dec
+                      << std::setw(12) << block->interrupts.load(relaxed)
+                      << std::setw(12) << Metrics::stopName(block->stop.load(relaxed))
+                      << std::setw(10) << std::fixed << std::setprecision(2)
+                      << (instructions ? static_cast<double>(ns) / instructions : 0.0) << "\n";
+        }
+        if (wait)
+            std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+    } while (wait);
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include "cpu.hpp"
+
+// state a routine returned with
+struct RoutineResult
+{
+    bool returned;
+    byte A, X, Y, P;
+    uint64_t cycles;
+    uint64_t instructions;
+};
+
+// loads code at org and calls it with the given registers. Runs in
+// constant expressions, so golden results can be checked at compile time
+template <std::size_t N>
+constexpr auto runRoutine(const byte (&code)[N], word org, byte a, byte x = 0, byte y = 0,
+                          uint64_t limit = 10000) -> RoutineResult
+{
+    CPU cpu{};
+    for (std::size_t i = 0; i < N; i++)
+        cpu.mem.ram[static_cast<word>(org + i)] = code[i];
+    cpu.SP = 0xFF;
+    cpu.A = a;
+    cpu.X = x;
+    cpu.Y = y;
+    bool returned = cpu.call(org, limit);
+
+    return {returned, cpu.A, cpu.X, cpu.Y, cpu.statusRegister(), cpu.cycles, cpu.instructions};
+}
+
+// calls the routine once for every value of A, each time on a fresh
+// CPU like runRoutine, and collects the A it returns, e.g. to bake a
+// lookup table into the binary:
+//     constexpr auto table = routineTable(code, 0x0200);
+template <std::size_t N>
+constexpr auto routineTable(const byte (&code)[N], word org, uint64_t limit = 10000) -> std::array<byte, 256>
+{
+    std::array<byte, 256> table{};
+    for (int value = 0; value < 256; value++)
+        table[value] = runRoutine(code, org, static_cast<byte>(value), 0, 0, limit).A;
+    return table;
+}
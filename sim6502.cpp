@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include "cpu.hpp"
+#include "metrics.hpp"
+#include "sim6502.h"
+
+struct sim6502
+{
+    CPU cpu;
+    Metrics metrics;
+};
+
+static_assert(sizeof(sim6502_registers) == 24);
+
+uint32_t sim6502_abi_version(void)
+{
+    return SIM6502_ABI_VERSION;
+}
+
+sim6502* sim6502_create(void)
+{
+    return new (std::nothrow) sim6502{};
+}
+
+void sim6502_destroy(sim6502* sim)
+{
+    delete sim;
+}
+
+void sim6502_power(sim6502* sim)
+{
+    sim->cpu.powerCPU();
+}
+
+void sim6502_reset(sim6502* sim)
+{
+    sim->cpu.resetCPU();
+}
+
+size_t sim6502_load(sim6502* sim, uint16_t addr, const uint8_t* data, size_t size)
+{
+    size = std::min<size_t>(size, CPU::Memory::size);
+    return sim->cpu.loadImage(data, static_cast<uint32_t>(size), addr);
+}
+
+int sim6502_run(sim6502* sim, uint64_t cycles)
+{
+    auto& cpu = sim->cpu;
+    cpu.run(cycles > UINT64_MAX - cpu.cycles ? UINT64_MAX : cpu.cycles + cycles);
+    return static_cast<int>(cpu.stop);
+}
+
+int sim6502_step(sim6502* sim, uint64_t instructions)
+{
+    sim->cpu.step(instructions);
+    return static_cast<int>(sim->cpu.stop);
+}
+
+void sim6502_get_registers(const sim6502* sim, sim6502_registers* regs)
+{
+    auto& cpu = sim->cpu;
+    *regs = {};
+    regs->pc = cpu.PC;
+    regs->sp = cpu.SP;
+    regs->a = cpu.A;
+    regs->x = cpu.X;
+    regs->y = cpu.Y;
+    regs->p = cpu.statusRegister();
+    regs->cycles = cpu.cycles;
+    regs->instructions = cpu.instructions;
+}
+
+void sim6502_set_registers(sim6502* sim, const sim6502_registers* regs)
+{
+    auto& cpu = sim->cpu;
+    cpu.PC = regs->pc;
+    cpu.SP = regs->sp;
+    cpu.A = regs->a;
+    cpu.X = regs->x;
+    cpu.Y = regs->y;
+    cpu.setStatusRegister(regs->p);
+    cpu.cycles = regs->cycles;
+    cpu.instructions = regs->instructions;
+}
+
+size_t sim6502_read(const sim6502* sim, uint16_t addr, uint8_t* data, size_t size)
+{
+    size = std::min<size_t>(size, CPU::Memory::size - addr);
+    memcpy(data, sim->cpu.mem.ram + addr, size);
+    return size;
+}
+
+size_t sim6502_write(sim6502* sim, uint16_t addr, const uint8_t* data, size_t size)
+{
+    return sim6502_load(sim, addr, data, size);
+}
+
+int sim6502_set_metrics_file(sim6502* sim, const char* path)
+{
+    sim->cpu.metrics = nullptr;
+    if (!path) {
+        sim->metrics.close();
+        return 1;
+    }
+    if (!sim->metrics.create(path))
+        return 0;
+    sim->cpu.metrics = &sim->metrics;
+    return 1;
+}
+
+int sim6502_set_io(sim6502* sim, uint8_t first, uint32_t count,
+                   sim6502_io_read read, sim6502_io_write write, void* user)
+{
+    if (count > CPU::pages - first)
+        return 0;
+    for (uint32_t page = first; page < first + count; page++)
+        sim->cpu.io[page] = {read, write, user, false};
+    return 1;
+}
+
+int sim6502_set_io_stable(sim6502* sim, uint8_t first, uint32_t count, int stable)
+{
+    if (count > CPU::pages - first)
+        return 0;
+    for (uint32_t page = first; page < first + count; page++)
+        sim->cpu.io[page].stable = stable != 0;
+    return 1;
+}
@@ -0,0 +1,89 @@
+/* libsim6502, C interface to the simulator.
+ * Every call works on a whole batch (cycles, instructions or bytes)
+ * so the cost of crossing the FFI boundary stays small. */
+#ifndef SIM6502_H
+#define SIM6502_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM6502_API __attribute__((visibility("default")))
+
+/* bumped whenever a struct layout or a signature changes */
+#define SIM6502_ABI_VERSION 1
+
+typedef struct sim6502 sim6502;
+
+typedef struct sim6502_registers
+{
+    uint16_t pc;
+    uint8_t sp;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t p;          /* N V - - D I Z C */
+    uint8_t reserved;
+    uint64_t cycles;
+    uint64_t instructions;
+} sim6502_registers;
+
+/* why the last run or step returned */
+enum
+{
+    SIM6502_RUNNING    = 0,
+    SIM6502_UNTIL      = 1,
+    SIM6502_BAD_OPCODE = 2
+};
+
+typedef uint8_t (*sim6502_io_read)(void* user, uint16_t addr);
+typedef void (*sim6502_io_write)(void* user, uint16_t addr, uint8_t data);
+
+SIM6502_API uint32_t sim6502_abi_version(void);
+
+SIM6502_API sim6502* sim6502_create(void);
+SIM6502_API void     sim6502_destroy(sim6502* sim);
+
+/* clears memory and resets */
+SIM6502_API void     sim6502_power(sim6502* sim);
+/* resets the registers and loads PC from the reset vector */
+SIM6502_API void     sim6502_reset(sim6502* sim);
+/* returns the number of bytes loaded, images are clipped at 0xFFFF */
+SIM6502_API size_t   sim6502_load(sim6502* sim, uint16_t addr, const uint8_t* data, size_t size);
+
+/* run for cycles more cycles or instructions more instructions,
+ * return a SIM6502_ stop reason */
+SIM6502_API int      sim6502_run(sim6502* sim, uint64_t cycles);
+SIM6502_API int      sim6502_step(sim6502* sim, uint64_t instructions);
+
+SIM6502_API void     sim6502_get_registers(const sim6502* sim, sim6502_registers* regs);
+SIM6502_API void     sim6502_set_registers(sim6502* sim, const sim6502_registers* regs);
+
+/* bulk copies that bypass I/O handlers, return the bytes copied */
+SIM6502_API size_t   sim6502_read(const sim6502* sim, uint16_t addr, uint8_t* data, size_t size);
+SIM6502_API size_t   sim6502_write(sim6502* sim, uint16_t addr, const uint8_t* data, size_t size);
+
+/* publishes metrics to a memory-mapped file that 6502stat can read,
+ * or stops publishing when path is NULL. Returns 0 on failure */
+SIM6502_API int      sim6502_set_metrics_file(sim6502* sim, const char* path);
+
+/* routes data reads and writes of pages [first, first + count) to the
+ * handlers, either of which may be NULL to use ram. Returns 0 if the
+ * pages are out of range */
+SIM6502_API int      sim6502_set_io(sim6502* sim, uint8_t first, uint32_t count,
+                                    sim6502_io_read read, sim6502_io_write write, void* user);
+
+/* marks pages [first, first + count) as stable: their read handler
+ * returns the same value for an address until the next run or step,
+ * which lets a loop polling them be skipped. sim6502_set_io clears
+ * it. Returns 0 if the pages are out of range */
+SIM6502_API int      sim6502_set_io_stable(sim6502* sim, uint8_t first, uint32_t count, int stable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+/* a C99 program using only sim6502.h, so the C interface stays
+ * usable from C and from FFIs that follow it */
+#include <stdint.h>
+#include <stdio.h>
+#include "sim6502.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+struct device
+{
+    uint8_t last;
+    unsigned writes;
+};
+
+static void deviceWrite(void* user, uint16_t addr, uint8_t data)
+{
+    struct device* device = (struct device*)user;
+    (void)addr;
+    device->last = data;
+    device->writes++;
+}
+
+int main(void)
+{
+    /* loop: INX, STX $D000, JMP loop */
+    static const uint8_t code[] = {0xE8, 0x8E, 0x00, 0xD0, 0x4C, 0x00, 0x03};
+    struct device device = {0, 0};
+    sim6502_registers regs;
+    uint8_t back[sizeof(code)];
+    sim6502* sim;
+    int stop;
+
+    CHECK(sim6502_abi_version() == SIM6502_ABI_VERSION);
+    sim = sim6502_create();
+    CHECK(sim != NULL);
+    if (!sim)
+        return 1;
+    sim6502_power(sim);
+
+    CHECK(sim6502_load(sim, 0x0300, code, sizeof(code)) == sizeof(code));
+    CHECK(sim6502_read(sim, 0x0300, back, sizeof(back)) == sizeof(back));
+    CHECK(back[0] == 0xE8 && back[6] == 0x03);
+    CHECK(sim6502_read(sim, 0xFFFF, back, sizeof(back)) == 1);
+
+    CHECK(sim6502_set_io(sim, 0xD0, 1, NULL, deviceWrite, &device) == 1);
+    CHECK(sim6502_set_io(sim, 0xF0, 0x11, NULL, deviceWrite, &device) == 0);
+    CHECK(sim6502_set_io(sim, 0xF0, 0xFFFFFF20u, NULL, deviceWrite, &device) == 0);
+    CHECK(sim6502_set_io_stable(sim, 0xF0, 0xFFFFFF20u, 1) == 0);
+
+    sim6502_get_registers(sim, &regs);
+    regs.pc = 0x0300;
+    regs.sp = 0xFF;
+    regs.x = 0;
+    regs.cycles = 0;
+    regs.instructions = 0;
+    sim6502_set_registers(sim, &regs);
+
+    /* 100 iterations of three instructions */
+    stop = sim6502_step(sim, 300);
+    CHECK(stop == SIM6502_UNTIL);
+    sim6502_get_registers(sim, &regs);
+    CHECK(regs.instructions == 300);
+    CHECK(regs.cycles == 300 * 3);
+    CHECK(regs.x == 100 && regs.pc == 0x0300);
+    CHECK(device.writes == 100 && device.last == 100);
+
+    stop = sim6502_run(sim, 900);
+    CHECK(stop == SIM6502_UNTIL);
+    sim6502_get_registers(sim, &regs);
+    CHECK(regs.cycles == 1800 && regs.x == 200);
+
+    /* 0x02 is not an opcode, it stops without retiring */
+    CHECK(sim6502_write(sim, 0x0400, (const uint8_t[]){0x02}, 1) == 1);
+    regs.pc = 0x0400;
+    sim6502_set_registers(sim, &regs);
+    stop = sim6502_step(sim, 10);
+    CHECK(stop == SIM6502_BAD_OPCODE);
+    sim6502_get_registers(sim, &regs);
+    CHECK(regs.pc == 0x0400 && regs.instructions == 600);
+
+    sim6502_destroy(sim);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include "cpu.hpp"
+
+// runs the same program with idle loop skipping on and off, in slices
+// with memory changed between some of them, and requires both to end
+// in exactly the same state
+
+static int failures = 0;
+
+static auto same(const CPU& a, const CPU& b, const char* name, int slice) -> void
+{
+    if (a.cycles == b.cycles && a.instructions == b.instructions && a.PC == b.PC &&
+        a.A == b.A && a.X == b.X && a.Y == b.Y && a.SP == b.SP &&
+        a.statusRegister() == b.statusRegister() && a.writeHash == b.writeHash)
+        return;
+
+    printf("%s, slice %d: skipping %llu cycles %llu instructions PC %x, "
+           "stepping %llu cycles %llu instructions PC %x\n", name, slice,
+           static_cast<unsigned long long>(a.cycles), static_cast<unsigned long long>(a.instructions), a.PC,
+           static_cast<unsigned long long>(b.cycles), static_cast<unsigned long long>(b.instructions), b.PC);
+    failures++;
+}
+
+// counts what run() executes: single instructions or skipped loops
+static auto count(void* user, CPU&) -> bool
+{
+    ++*static_cast<uint64_t*>(user);
+    return true;
+}
+
+template <size_t N>
+static auto check(const char* name, const byte (&code)[N], word org, word status) -> void
+{
+    auto skipping = std::make_unique<CPU>();
+    auto stepping = std::make_unique<CPU>();
+    for (auto cpu : {skipping.get(), stepping.get()}) {
+        cpu->loadImage(code, N, org);
+        cpu->PC = org;
+        cpu->SP = 0xFF;
+    }
+    stepping->idleSkip = false;
+    uint64_t events[2]{};
+    skipping->watch = stepping->watch = count;
+    skipping->watchUser = &events[0];
+    stepping->watchUser = &events[1];
+
+    // odd slice lengths, so slices end in the middle of iterations
+    uint64_t until = 0;
+    for (int slice = 0; slice < 12; slice++) {
+        until += 99991 + slice * 7;
+        skipping->run(until);
+        stepping->run(until);
+        same(*skipping, *stepping, name, slice);
+
+        // the device sets the flag for a while, then clears it
+        if (slice == 3 || slice == 7) {
+            skipping->mem.ram[status] = stepping->mem.ram[status] = 1;
+        } else if (slice == 5 || slice == 9) {
+            skipping->mem.ram[status] = stepping->mem.ram[status] = 0;
+        }
+    }
+
+    // matching alone would pass with skipping never happening
+    if (events[0] * 2 > events[1]) {
+        printf("%s: %llu steps skipping, %llu stepping\n", name,
+               static_cast<unsigned long long>(events[0]), static_cast<unsigned long long>(events[1]));
+        failures++;
+    }
+}
+
+// a device register that only changes between slices
+struct Device
+{
+    byte value;
+    uint64_t reads;
+};
+
+static auto readDevice(void* user, word) -> byte
+{
+    auto device = static_cast<Device*>(user);
+    device->reads++;
+    return device->value;
+}
+
+// polling a stable I/O page must skip like ram and still stop
+// exactly where stepping does
+static auto checkStable(void) -> void
+{
+    // wait: LDA $D000, BEQ wait, INY, JMP wait
+    constexpr byte code[] = {0xAD, 0x00, 0xD0, 0xF0, 0xFB, 0xC8, 0x4C, 0x00, 0x03};
+    Device devices[2]{};
+    auto skipping = std::make_unique<CPU>();
+    auto stepping = std::make_unique<CPU>();
+    CPU* cpus[2] = {skipping.get(), stepping.get()};
+    for (int i = 0; i < 2; i++) {
+        cpus[i]->loadImage(code, sizeof(code), 0x0300);
+        cpus[i]->PC = 0x0300;
+        cpus[i]->SP = 0xFF;
+        cpus[i]->io[0xD0] = {readDevice, nullptr, &devices[i], true};
+    }
+    stepping->idleSkip = false;
+
+    uint64_t until = 0;
+    for (int slice = 0; slice < 12; slice++) {
+        until += 99991 + slice * 7;
+        skipping->run(until);
+        stepping->run(until);
+        same(*skipping, *stepping, "stable I/O", slice);
+        if (slice == 3 || slice == 7) {
+            devices[0].value = devices[1].value = 1;
+        } else if (slice == 5 || slice == 9) {
+            devices[0].value = devices[1].value = 0;
+        }
+    }
+    // the four slices with the flag set are not idle, the rest
+    // should hardly read the device at all
+    if (devices[0].reads * 2 > devices[1].reads) {
+        printf("stable I/O: %llu reads skipping, %llu stepping\n",
+               static_cast<unsigned long long>(devices[0].reads),
+               static_cast<unsigned long long>(devices[1].reads));
+        failures++;
+    }
+}
+
+// a heat map has to count every iteration of a spin loop
+static auto checkHeat(void) -> void
+{
+    // JMP *
+    constexpr byte spin[] = {0x4C, 0x03, 0x03};
+    auto cpu = std::make_unique<CPU>();
+    CPU::Heat heat{};
+    cpu->loadImage(spin, sizeof(spin), 0x0303);
+    cpu->PC = 0x0303;
+    cpu->heat = &heat;
+    cpu->run(100000);
+    if (heat.reads[0x03] != cpu->instructions * 3) {
+        printf("heat: %u reads of page 3 for %llu instructions\n", heat.reads[0x03],
+               static_cast<unsigned long long>(cpu->instructions));
+        failures++;
+    }
+}
+
+int main()
+{
+    // wait: LDA $10, BEQ wait, INX, STX $11, JMP wait
+    constexpr byte zeroPage[] = {0xA5, 0x10, 0xF0, 0xFC, 0xE8, 0x86, 0x11, 0x4C, 0x00, 0x03};
+    check("LDA zp / BEQ", zeroPage, 0x0300, 0x0010);
+
+    // wait: LDA $D000, BEQ wait, INY, JMP wait
+    constexpr byte absolute[] = {0xAD, 0x00, 0xD0, 0xF0, 0xFB, 0xC8, 0x4C, 0x00, 0x03};
+    check("LDA abs / BEQ", absolute, 0x0300, 0xD000);
+
+    // INX, JMP *
+    constexpr byte forever[] = {0xE8, 0x4C, 0x01, 0x03};
+    check("JMP *", forever, 0x0300, 0x0010);
+
+    checkStable();
+    checkHeat();
+
+    return failures ? 1 : 0;
+}
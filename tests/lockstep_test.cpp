@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <memory>
+#include "lockstep.hpp"
+
+// plants a divergence in the fast engine and requires the report to
+// name the instruction it happened at
+
+static int failures = 0;
+
+template <size_t N>
+static auto load(CPU& cpu, const byte (&code)[N]) -> void
+{
+    cpu.loadImage(code, N, 0x0300);
+    cpu.PC = 0x0300;
+    cpu.SP = 0xFF;
+}
+
+static auto expect(bool ok, const char* name, const Lockstep& lockstep) -> void
+{
+    if (ok)
+        return;
+    printf("%s: diverged at %llu\n%s", name,
+           static_cast<unsigned long long>(lockstep.divergedAt), lockstep.report.c_str());
+    failures++;
+}
+
+// corrupts Y on the store retired as instruction 776
+static auto corrupt(void* user, word, byte) -> void
+{
+    auto cpu = static_cast<CPU*>(user);
+    if (cpu->instructions == 776)
+        cpu->Y ^= 0x80;
+}
+
+// a device that changes while claiming to be stable, which only
+// the skipping engine gets wrong
+static auto lie(void* user, word) -> byte
+{
+    return static_cast<CPU*>(user)->instructions >= 777;
+}
+
+int main()
+{
+    // loop: INX, STX $D000, JMP loop
+    constexpr byte store[] = {0xE8, 0x8E, 0x00, 0xD0, 0x4C, 0x00, 0x03};
+    // spin: LDA $D000, BEQ spin, LDY #1, JMP *
+    constexpr byte poll[] = {0xAD, 0x00, 0xD0, 0xF0, 0xFB, 0xA0, 0x01, 0x4C, 0x07, 0x03};
+    // INX, JMP *
+    constexpr byte forever[] = {0xE8, 0x4C, 0x01, 0x03};
+
+    {
+        auto a = std::make_unique<CPU>();
+        auto b = std::make_unique<CPU>();
+        load(*a, store);
+        load(*b, store);
+        b->io[0xD0] = {nullptr, corrupt, b.get(), false};
+        Lockstep lockstep;
+        lockstep.every = 500;
+        bool agreed = lockstep.run(*a, *b, 3000);
+        expect(!agreed && lockstep.divergedAt == 776, "corrupted store", lockstep);
+    }
+
+    {
+        auto a = std::make_unique<CPU>();
+        auto b = std::make_unique<CPU>();
+        load(*a, poll);
+        load(*b, poll);
+        a->io[0xD0] = {lie, nullptr, a.get(), true};
+        b->io[0xD0] = {lie, nullptr, b.get(), true};
+        Lockstep lockstep;
+        lockstep.every = 500;
+        bool agreed = lockstep.run(*a, *b, 3000);
+        expect(!agreed && lockstep.divergedAt >= 777 && lockstep.divergedAt <= 1000 &&
+               lockstep.report.find("skipped") != std::string::npos, "unstable device", lockstep);
+    }
+
+    {
+        auto a = std::make_unique<CPU>();
+        auto b = std::make_unique<CPU>();
+        load(*a, forever);
+        load(*b, forever);
+        Lockstep lockstep;
+        bool agreed = lockstep.run(*a, *b, 100000);
+        expect(agreed && b->instructions == 100000, "JMP *", lockstep);
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "memview.hpp"
+
+// checks diffMemory against a byte by byte diff, on whichever of the
+// AVX2, SSE2 or scalar block compares this build uses, and one hexDump
+
+static int failures = 0;
+
+static auto naiveDiff(const byte* a, const byte* b, uint32_t size) -> std::vector<MemoryRange>
+{
+    std::vector<MemoryRange> ranges;
+    for (uint32_t i = 0; i < size; i++) {
+        if (a[i] == b[i])
+            continue;
+        if (!ranges.empty() && ranges.back().last == i)
+            ranges.back().last = i + 1;
+        else
+            ranges.push_back({i, i + 1});
+    }
+    return ranges;
+}
+
+static auto expect(const std::vector<byte>& a, const std::vector<byte>& b, const char* name) -> void
+{
+    auto size = static_cast<uint32_t>(a.size());
+    auto got = diffMemory(a.data(), b.data(), size);
+    auto want = naiveDiff(a.data(), b.data(), size);
+    bool same = got.size() == want.size();
+    for (size_t i = 0; same && i < got.size(); i++)
+        same = got[i].first == want[i].first && got[i].last == want[i].last;
+    if (same)
+        return;
+
+    printf("%s, size %u: %zu ranges, expected %zu\n", name, size, got.size(), want.size());
+    for (size_t i = 0; i < got.size() || i < want.size(); i++) {
+        if (i < got.size())
+            printf("  got %x-%x", got[i].first, got[i].last);
+        if (i < want.size())
+            printf("  expected %x-%x", want[i].first, want[i].last);
+        printf("\n");
+    }
+    failures++;
+}
+
+// b differs from a over [first, last)
+static auto expectRange(uint32_t size, uint32_t first, uint32_t last, const char* name) -> void
+{
+    std::vector<byte> a(size, 0x55), b(size, 0x55);
+    for (uint32_t i = first; i < last; i++)
+        b[i] = 0xAA;
+    expect(a, b, name);
+}
+
+static auto checkDiff(void) -> void
+{
+    expect({}, {}, "empty");
+    expectRange(64, 0, 0, "equal");
+    expectRange(64, 0, 64, "all different");
+    expectRange(64, 30, 34, "across a block boundary");
+    expectRange(96, 31, 65, "over a whole block");
+    expectRange(96, 32, 64, "exactly one block");
+    expectRange(45, 40, 45, "open at the end of the tail");
+    expectRange(64, 50, 64, "open at the end of a block");
+    expectRange(77, 20, 77, "open from a block into the tail");
+    expectRange(31, 3, 9, "shorter than a block");
+
+    // sparse and dense random changes, sizes around the block length
+    std::mt19937 rng(6502);
+    for (int round = 0; round < 2000; round++) {
+        uint32_t size = rng() % 200;
+        std::vector<byte> a(size), b(size);
+        for (auto& value : a)
+            value = static_cast<byte>(rng());
+        b = a;
+        uint32_t changes = rng() % (size + 1);
+        for (uint32_t i = 0; i < changes && size; i++)
+            b[rng() % size] ^= static_cast<byte>(1 + rng() % 255);
+        expect(a, b, "random");
+    }
+
+    // the CPU::Memory overload covers the whole 64 KiB
+    auto x = std::make_unique<CPU::Memory>();
+    auto y = std::make_unique<CPU::Memory>();
+    y->ram[0xFFFF] = 1;
+    auto ranges = diffMemory(*x, *y);
+    if (ranges.size() != 1 || ranges[0].first != 0xFFFF || ranges[0].last != 0x10000) {
+        printf("CPU::Memory: last byte not found\n");
+        failures++;
+    }
+}
+
+static auto checkDump(void) -> void
+{
+    byte data[0x20]{};
+    const char text[] = "Hello, 6502!";
+    for (int i = 0; i < 12; i++)
+        data[0x10 + i] = text[i];
+    data[0x1C] = 0x00;
+    data[0x1D] = 0x01;
+    data[0x1E] = 0x7F;
+    data[0x1F] = 0xFF;
+
+    std::string out;
+    hexDump(out, data, 0x10, 0x20);
+    const std::string full =
+        "0010: 48 65 6c 6c 6f 2c 20 36 35 30 32 21 00 01 7f ff  |Hello, 6502!....|\n";
+    if (out != full) {
+        printf("hexDump:\n%sexpected:\n%s", out.c_str(), full.c_str());
+        failures++;
+    }
+
+    // bytes outside [first, last) are left blank
+    out.clear();
+    hexDump(out, data, 0x12, 0x15);
+    const std::string partial =
+        "0010:       6c 6c 6f " + std::string(11 * 3 + 1, ' ') + "|  llo           |\n";
+    if (out != partial) {
+        printf("hexDump:\n%sexpected:\n%s", out.c_str(), partial.c_str());
+        failures++;
+    }
+}
+
+int main()
+{
+    checkDiff();
+    checkDump();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// one writer and one reader exchange whole T values without locks.
+// The writer fills back() and publishes it, the reader takes the most
+// recent published value with front(). Neither ever waits for the other
+template <typename T>
+class TripleBuffer
+{
+public:
+    // owned by the writer until publish()
+    auto back(void) -> T&
+    {
+        return buffers[backIndex];
+    }
+
+    auto publish(void) -> void
+    {
+        backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & index;
+    }
+
+    // latest published value, owned by the reader until the next call
+    auto front(void) -> const T&
+    {
+        if (middle.load(std::memory_order_relaxed) & fresh)
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & index;
+        return buffers[frontIndex];
+    }
+
+    // true if publish() was called since the last front()
+    auto updated(void) const -> bool
+    {
+        return middle.load(std::memory_order_relaxed) & fresh;
+    }
+
+private:
+    constexpr static uint8_t index{0x03};
+    constexpr static uint8_t fresh{0x04};
+
+    T buffers[3]{};
+    uint8_t backIndex{0};
+    std::atomic<uint8_t> middle{1};
+    uint8_t frontIndex{2};
+};
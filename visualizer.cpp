@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <SDL.h>
+#include "visualizer.hpp"
+
+constexpr int width{640};
+constexpr int height{360};
+constexpr int cell{10};
+
+Visualizer::~Visualizer()
+{
+    stop();
+}
+
+auto Visualizer::start(bool headless) -> bool
+{
+    if (thread.joinable())
+        return true;
+
+    alive = true;
+    ready = false;
+    failed = false;
+    thread = std::thread(&Visualizer::loop, this, headless);
+    while (!ready && !failed)
+        std::this_thread::yield();
+    if (failed) {
+        thread.join();
+        return false;
+    }
+    return true;
+}
+
+auto Visualizer::stop(void) -> void
+{
+    alive = false;
+    if (thread.joinable())
+        thread.join();
+}
+
+auto Visualizer::running(void) const -> bool
+{
+    return alive;
+}
+
+auto Visualizer::attach(CPU& cpu) -> void
+{
+    cpu.heat = &heat;
+}
+
+auto Visualizer::publish(const CPU& cpu) -> void
+{
+    auto& frame = buffer.back();
+    frame.PC = cpu.PC;
+    frame.SP = cpu.SP;
+    frame.A = cpu.A;
+    frame.X = cpu.X;
+    frame.Y = cpu.Y;
+    frame.P = cpu.statusRegister();
+    frame.cycles = cpu.cycles;
+    frame.instructions = cpu.instructions;
+    frame.heat = heat;
+    memcpy(frame.stack, cpu.mem.ram + 0x100, sizeof(frame.stack));
+    buffer.publish();
+
+    heat = {};
+}
+
+// one box per bit, most significant first
+static auto drawBits(SDL_Renderer* renderer, int x, int y, uint32_t value, int bits, SDL_Color on) -> void
+{
+    for (int bit = bits - 1; bit >= 0; bit--, x += cell + 2) {
+        SDL_Rect box{x, y, cell, cell};
+        if ((value >> bit) & 1)
+            SDL_SetRenderDrawColor(renderer, on.r, on.g, on.b, 255);
+        else
+            SDL_SetRenderDrawColor(renderer, 40, 40, 40, 255);
+        SDL_RenderFillRect(renderer, &box);
+    }
+}
+
+// log scale so a page touched once is still visible next to a hot loop
+static auto intensity(uint32_t count) -> uint8_t
+{
+    if (!count)
+        return 0;
+    return static_cast<uint8_t>(std::min(255.0, 64 + 24 * std::log2(static_cast<double>(count))));
+}
+
+static auto draw(SDL_Renderer* renderer, const Visualizer::Frame& frame) -> void
+{
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    // registers, one row each: PC, SP, A, X, Y, then N V - - D I Z C
+    constexpr SDL_Color white{220, 220, 220, 255};
+    constexpr SDL_Color yellow{230, 200, 40, 255};
+    int y = 10;
+    drawBits(renderer, 10, y, frame.PC, 16, white);
+    for (auto reg : {frame.SP, frame.A, frame.X, frame.Y})
+        drawBits(renderer, 10, y += cell + 4, reg, 8, white);
+    drawBits(renderer, 10, y += cell + 8, frame.P, 8, yellow);
+
+    // heat map, a cell per page: green reads, red writes
+    int left = 220;
+    for (int page = 0; page < 0x100; page++) {
+        SDL_Rect box{left + (page % 16) * (cell + 1), 10 + (page / 16) * (cell + 1), cell, cell};
+        SDL_SetRenderDrawColor(renderer, intensity(frame.heat.writes[page]),
+                               intensity(frame.heat.reads[page]), 0, 255);
+        SDL_RenderFillRect(renderer, &box);
+    }
+
+    // stack page, a cell per byte, SP outlined
+    left = 430;
+    for (int i = 0; i < 0x100; i++) {
+        SDL_Rect box{left + (i % 16) * (cell + 1), 10 + (i / 16) * (cell + 1), cell, cell};
+        SDL_SetRenderDrawColor(renderer, frame.stack[i], frame.stack[i], frame.stack[i], 255);
+        SDL_RenderFillRect(renderer, &box);
+        if (i == frame.SP) {
+            SDL_SetRenderDrawColor(renderer, yellow.r, yellow.g, yellow.b, 255);
+            SDL_RenderDrawRect(renderer, &box);
+        }
+    }
+}
+
+auto Visualizer::loop(bool headless) -> void
+{
+    if (headless)
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        std::cerr << "SDL_Init: " << SDL_GetError() << "\n";
+        alive = false;
+        failed = true;
+        return;
+    }
+
+    SDL_Window* window = nullptr;
+    SDL_Surface* surface = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    if (headless) {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+        if (surface)
+            renderer = SDL_CreateSoftwareRenderer(surface);
+    } else {
+        window = SDL_CreateWindow("6502", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                  width, height, 0);
+        if (window)
+            renderer = SDL_CreateRenderer(window, -1, 0);
+    }
+    if (!renderer) {
+        std::cerr << "SDL renderer: " << SDL_GetError() << "\n";
+        if (surface)
+            SDL_FreeSurface(surface);
+        if (window)
+            SDL_DestroyWindow(window);
+        SDL_Quit();
+        alive = false;
+        failed = true;
+        return;
+    }
+    ready = true;
+
+    using clock = std::chrono::steady_clock;
+    constexpr auto period = std::chrono::microseconds(1000000 / 60);
+    auto next = clock::now();
+
+    while (alive) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT)
+                alive = false;
+        }
+
+        draw(renderer, buffer.front());
+        SDL_RenderPresent(renderer);
+        frames++;
+
+        next += period;
+        std::this_thread::sleep_until(next);
+        // don't try to catch up after a stall
+        if (clock::now() > next + period)
+            next = clock::now();
+    }
+
+    if (surface && !screenshot.empty())
+        SDL_SaveBMP(surface, screenshot.c_str());
+
+    SDL_DestroyRenderer(renderer);
+    if (surface)
+        SDL_FreeSurface(surface);
+    if (window)
+        SDL_DestroyWindow(window);
+    SDL_Quit();
+}
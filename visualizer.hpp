@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "cpu.hpp"
+#include "triplebuffer.hpp"
+
+// draws the registers, flags, a per page read/write heat map and the
+// stack page at 60 Hz on its own thread. The emulation thread hands
+// over state with publish(), which copies into a triple buffer and
+// never waits for rendering
+class Visualizer
+{
+public:
+    // what one frame shows
+    struct Frame
+    {
+        word PC;
+        byte SP, A, X, Y, P;
+        uint64_t cycles;
+        uint64_t instructions;
+        CPU::Heat heat;
+        byte stack[0x100];
+    };
+
+    ~Visualizer();
+
+    // headless renders to an offscreen surface with SDL's dummy driver
+    auto start(bool headless) -> bool;
+    auto stop(void)           -> void;
+    auto running(void) const  -> bool;
+
+    // called from the emulation thread. Points cpu.heat at our counters,
+    // which restart from zero with every published frame
+    auto attach(CPU& cpu)        -> void;
+    auto publish(const CPU& cpu) -> void;
+
+    std::atomic<uint64_t> frames{0}; // frames rendered
+    std::string screenshot;          // if set, the last frame is saved here as BMP on stop
+
+private:
+    auto loop(bool headless) -> void;
+
+    TripleBuffer<Frame> buffer;
+    CPU::Heat heat{};
+    std::thread thread;
+    std::atomic<bool> alive{false};
+    std::atomic<bool> ready{false};
+    std::atomic<bool> failed{false};
+};
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "metrics.hpp"
+#include "visualizer.hpp"
+
+// 6502view image load-addr entry [-hz cycles-per-second] [-headless seconds] [-o frame.bmp] [-m metrics]
+// runs an image at the given clock (0 for as fast as possible) and
+// shows it until the window is closed, or for some seconds headless
+int main(int argc, char* args[])
+{
+    uint64_t hz = 1000000;
+    double seconds = 0;
+    bool headless = false;
+    auto vis = std::make_unique<Visualizer>();
+    Metrics metrics;
+    const char* metricsPath = nullptr;
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(args[i], "-hz") == 0) {
+            hz = strtoull(args[++i], nullptr, 0);
+        } else if (i + 1 < argc && strcmp(args[i], "-headless") == 0) {
+            headless = true;
+            seconds = strtod(args[++i], nullptr);
+        } else if (i + 1 < argc && strcmp(args[i], "-o") == 0) {
+            vis->screenshot = args[++i];
+        } else if (i + 1 < argc && strcmp(args[i], "-m") == 0) {
+            metricsPath = args[++i];
+        } else {
+            positional.push_back(args[i]);
+        }
+    }
+    if (positional.size() != 3) {
+        std::cerr << "usage: " << args[0]
+                  << " image load-addr entry [-hz cycles-per-second] [-headless seconds] [-o frame.bmp] [-m metrics]\n";
+        return EXIT_FAILURE;
+    }
+
+    auto cpu = std::make_unique<CPU>();
+    if (!cpu->loadFile(positional[0], strtoul(positional[1], nullptr, 0))) {
+        std::cerr << "Can't read image: " << positional[0] << "\n";
+        return EXIT_FAILURE;
+    }
+    cpu->SP = 0xFF;
+    cpu->I = 1;
+    cpu->PC = strtoul(positional[2], nullptr, 0);
+    if (metricsPath) {
+        if (!metrics.create(metricsPath)) {
+            std::cerr << "Can't create metrics: " << metricsPath << "\n";
+            return EXIT_FAILURE;
+        }
+        cpu->metrics = &metrics;
+    }
+
+    vis->attach(*cpu);
+    if (!vis->start(headless))
+        return EXIT_FAILURE;
+
+    // emulate in slices of a frame, publishing after each
+    using clock = std::chrono::steady_clock;
+    constexpr auto slice = std::chrono::microseconds(1000000 / 60);
+    auto start = clock::now();
+    auto next = start;
+    while (vis->running()) {
+        if (headless && clock::now() - start >= std::chrono::duration<double>(seconds))
+            break;
+        if (cpu->stop != CPU::Stop::BadOpcode)
+            cpu->run(cpu->cycles + (hz ? hz / 60 : 100000));
+        vis->publish(*cpu);
+        if (hz || cpu->stop == CPU::Stop::BadOpcode) {
+            next += slice;
+            std::this_thread::sleep_until(next);
+        }
+    }
+    vis->stop();
+
+    std::cout << "frames: " << vis->frames << "  instructions: " << cpu->instructions
+              << "  cycles: " << cpu->cycles << "\n";
+    return 0;
+}